@@ -0,0 +1,149 @@
+#include "AsyncFaceDetector.h"
+#include <algorithm>
+
+AsyncFaceDetector::AsyncFaceDetector(const std::string cascadeFilePath, const size_t maxInFlight)
+    : m_detector(cascadeFilePath), m_maxInFlight(std::max(maxInFlight, (size_t)1))
+{
+    m_worker = std::thread(&AsyncFaceDetector::run, this);
+}
+
+/*
+* Frames already submitted are still processed and delivered.
+*/
+AsyncFaceDetector::~AsyncFaceDetector()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_jobAvailable.notify_all();
+    m_worker.join();
+}
+
+/*
+* Blocks while the in-flight window is full.
+*/
+std::future<DetectionResult> AsyncFaceDetector::submit(const cv::Mat &frame, const double timestamp)
+{
+    Job job;
+    job.timestamp = timestamp;
+    job.frame = frame;
+    job.hasPromise = true;
+    std::future<DetectionResult> result = job.promise.get_future();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_slotAvailable.wait(lock, [this] { return m_inFlight < m_maxInFlight; });
+    enqueue(job, lock);
+    return result;
+}
+
+/*
+* Blocks while the in-flight window is full and returns the frame id the
+* callback will receive. The callback runs on the worker thread.
+*/
+uint64 AsyncFaceDetector::submit(const cv::Mat &frame, const double timestamp, ResultCallback callback)
+{
+    Job job;
+    job.timestamp = timestamp;
+    job.frame = frame;
+    job.callback = callback;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_slotAvailable.wait(lock, [this] { return m_inFlight < m_maxInFlight; });
+    return enqueue(job, lock);
+}
+
+/*
+* Non-blocking submit, returns false and drops the frame if the in-flight
+* window is full.
+*/
+bool AsyncFaceDetector::trySubmit(const cv::Mat &frame, const double timestamp, ResultCallback callback)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_inFlight >= m_maxInFlight)
+        return false;
+
+    Job job;
+    job.timestamp = timestamp;
+    job.frame = frame;
+    job.callback = callback;
+    enqueue(job, lock);
+    return true;
+}
+
+/*
+* Blocks until every submitted frame has been delivered.
+*/
+void AsyncFaceDetector::flush()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_slotAvailable.wait(lock, [this] { return m_inFlight == 0; });
+}
+
+size_t AsyncFaceDetector::inFlight() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_inFlight;
+}
+
+size_t AsyncFaceDetector::maxInFlight() const
+{
+    return m_maxInFlight;
+}
+
+/*
+* The detector is used by the worker thread, configure it before the first
+* submit or after flush().
+*/
+VideoFaceDetector &AsyncFaceDetector::detector()
+{
+    return m_detector;
+}
+
+uint64 AsyncFaceDetector::enqueue(Job &job, std::unique_lock<std::mutex> &lock)
+{
+    job.frameId = m_nextFrameId++;
+    uint64 frameId = job.frameId;
+    m_jobs.push_back(std::move(job));
+    m_inFlight++;
+    lock.unlock();
+    m_jobAvailable.notify_one();
+    return frameId;
+}
+
+/*
+* Single worker so tracking sees frames in submission order.
+*/
+void AsyncFaceDetector::run()
+{
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_jobAvailable.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+            if (m_jobs.empty())
+                return;
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        m_detector.detect(job.frame, job.timestamp);
+
+        DetectionResult result;
+        result.frameId = job.frameId;
+        result.timestamp = job.timestamp;
+        result.faces = m_detector.faces();
+        job.frame.release();
+
+        if (job.hasPromise)
+            job.promise.set_value(std::move(result));
+        else if (job.callback)
+            job.callback(result);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_inFlight--;
+        }
+        m_slotAvailable.notify_all();
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <opencv2\core.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "VideoFaceDetector.h"
+
+struct DetectionResult
+{
+    uint64                      frameId;
+    double                      timestamp;
+    std::vector<TrackedFace>    faces;
+};
+
+/*
+* Push style front end of a VideoFaceDetector. Frames submitted from any
+* source are detected on a worker thread in submission order and results are
+* delivered through a future or a callback, also in submission order. At most
+* maxInFlight frames are queued or being processed at any time.
+*
+* Frames are not copied: the caller must not write into a submitted frame
+* until its result has been delivered.
+*/
+class AsyncFaceDetector
+{
+public:
+    typedef std::function<void(const DetectionResult&)> ResultCallback;
+
+    AsyncFaceDetector(const std::string cascadeFilePath, const size_t maxInFlight = 4);
+    ~AsyncFaceDetector();
+
+    std::future<DetectionResult>    submit(const cv::Mat &frame, const double timestamp);
+    uint64                          submit(const cv::Mat &frame, const double timestamp, ResultCallback callback);
+    bool                            trySubmit(const cv::Mat &frame, const double timestamp, ResultCallback callback);
+    void                            flush();
+    size_t                          inFlight() const;
+    size_t                          maxInFlight() const;
+    VideoFaceDetector&              detector();
+
+private:
+    struct Job
+    {
+        uint64                          frameId;
+        double                          timestamp;
+        cv::Mat                         frame;
+        ResultCallback                  callback;
+        std::promise<DetectionResult>   promise;
+        bool                            hasPromise = false;
+    };
+
+    VideoFaceDetector               m_detector;
+    size_t                          m_maxInFlight;
+    size_t                          m_inFlight = 0;
+    uint64                          m_nextFrameId = 0;
+    bool                            m_stopping = false;
+    std::deque<Job>                 m_jobs;
+    mutable std::mutex              m_mutex;
+    std::condition_variable         m_jobAvailable;
+    std::condition_variable         m_slotAvailable;
+    std::thread                     m_worker;
+
+    uint64  enqueue(Job &job, std::unique_lock<std::mutex> &lock);
+    void    run();
+};
@@ -0,0 +1,97 @@
+#include "CadenceScheduler.h"
+#include <algorithm>
+#include <cmath>
+
+const double CadenceScheduler::SMOOTHING = 0.1;
+
+CadenceScheduler::CadenceScheduler()
+{
+}
+
+/*
+* Budget of 0 disables scheduling, the cascade then runs on every frame.
+*/
+void CadenceScheduler::setFrameTimeBudget(const double s)
+{
+    m_frameTimeBudget = std::max(s, 0.);
+    updateInterval();
+}
+
+double CadenceScheduler::frameTimeBudget() const
+{
+    return m_frameTimeBudget;
+}
+
+void CadenceScheduler::setMaxInterval(const int frames)
+{
+    m_maxInterval = std::max(frames, 1);
+    updateInterval();
+}
+
+int CadenceScheduler::maxInterval() const
+{
+    return m_maxInterval;
+}
+
+int CadenceScheduler::interval() const
+{
+    return m_interval;
+}
+
+/*
+* Returns true if the cascade should run on this frame.
+*/
+bool CadenceScheduler::beginFrame()
+{
+    if (m_frameTimeBudget <= 0 || m_framesSinceCascade + 1 >= m_interval) {
+        m_framesSinceCascade = 0;
+        return true;
+    }
+
+    m_framesSinceCascade++;
+    return false;
+}
+
+/*
+* Feeds the detection time of a frame back into the cost estimates.
+*/
+void CadenceScheduler::endFrame(const double s, const bool cascadeFrame)
+{
+    double &average = cascadeFrame ? m_cascadeFrameTime : m_templateFrameTime;
+    average = average == 0 ? s : average + SMOOTHING * (s - average);
+    updateInterval();
+}
+
+void CadenceScheduler::reset()
+{
+    m_interval = 1;
+    m_framesSinceCascade = 0;
+    m_cascadeFrameTime = m_templateFrameTime = 0;
+}
+
+/*
+* Average frame time over an interval of N frames is (C + (N - 1) * T) / N
+* for cascade frame time C and template frame time T. Picks the smallest N
+* keeping that within budget.
+*/
+void CadenceScheduler::updateInterval()
+{
+    if (m_frameTimeBudget <= 0 || m_cascadeFrameTime <= m_frameTimeBudget) {
+        m_interval = 1;
+        return;
+    }
+
+    if (m_templateFrameTime == 0) {
+        // No template frame measured yet, try one
+        m_interval = std::min(2, m_maxInterval);
+        return;
+    }
+
+    if (m_templateFrameTime >= m_frameTimeBudget) {
+        m_interval = m_maxInterval;
+        return;
+    }
+
+    double frames = std::ceil((m_cascadeFrameTime - m_templateFrameTime) / (m_frameTimeBudget - m_templateFrameTime));
+    m_interval = std::max(1, std::min((int)frames, m_maxInterval));
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+/*
+* Decides on which frames tracked faces are re-detected with the cascade.
+* Frames in between are tracked with template matching. The cascade interval
+* is derived from the measured cost of cascade and template frames so that
+* the average frame time stays within the configured budget.
+*/
+class CadenceScheduler
+{
+public:
+    CadenceScheduler();
+
+    void    setFrameTimeBudget(const double s);
+    double  frameTimeBudget() const;
+    void    setMaxInterval(const int frames);
+    int     maxInterval() const;
+    int     interval() const;
+    bool    beginFrame();
+    void    endFrame(const double s, const bool cascadeFrame);
+    void    reset();
+
+private:
+    static const double SMOOTHING;
+
+    double  m_frameTimeBudget = 0;
+    int     m_maxInterval = 10;
+    int     m_interval = 1;
+    int     m_framesSinceCascade = 0;
+    double  m_cascadeFrameTime = 0;
+    double  m_templateFrameTime = 0;
+
+    void    updateInterval();
+};
@@ -0,0 +1,62 @@
+#include "CaptureThread.h"
+
+CaptureThread::CaptureThread(cv::VideoCapture &videoCapture, const size_t queueSize, const FrameQueue::OverflowPolicy policy,
+    FrameCallback frameCallback)
+    : m_videoCapture(&videoCapture), m_queue(queueSize, policy), m_frameCallback(frameCallback), m_running(true)
+{
+    m_thread = std::thread(&CaptureThread::run, this);
+}
+
+CaptureThread::~CaptureThread()
+{
+    stop();
+}
+
+bool CaptureThread::read(cv::Mat &frame, FrameStamp *stamp)
+{
+    return m_queue.read(frame, stamp);
+}
+
+bool CaptureThread::tryRead(cv::Mat &frame, FrameStamp *stamp)
+{
+    return m_queue.tryRead(frame, stamp);
+}
+
+void CaptureThread::stop()
+{
+    m_running = false;
+    m_queue.close();
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+const FrameQueue &CaptureThread::queue() const
+{
+    return m_queue;
+}
+
+void CaptureThread::run()
+{
+    while (m_running) {
+        cv::Mat *slot = m_queue.beginWrite();
+        if (slot == NULL)
+            break;
+
+        // End of stream or camera error
+        if (!m_videoCapture->read(*slot) || slot->empty())
+            break;
+
+        // The ring is sized and typed after the first frame, whatever format the capture delivers
+        if (m_sequence == 0)
+            m_queue.preallocate(slot->size(), slot->type());
+
+        m_queue.endWrite(FrameStamp(++m_sequence, m_videoCapture->get(cv::CAP_PROP_POS_MSEC),
+            std::chrono::steady_clock::now()));
+        if (m_frameCallback)
+            m_frameCallback();
+    }
+
+    m_queue.close();
+    if (m_frameCallback)
+        m_frameCallback();
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <opencv2\core.hpp>
+#include <opencv2\highgui\highgui.hpp>
+
+#include <atomic>
+#include <functional>
+#include <thread>
+
+#include "FrameQueue.h"
+
+/*
+* Reads frames from a VideoCapture on its own thread into a FrameQueue so
+* capture and decode time overlap with detection. Frames are stamped with
+* their sequence number, so dropped frames leave gaps, and capture time.
+* read() swaps the frame with the caller's buffer, which is decoded into
+* again later, so frames are never copied once the ring is warm. The
+* optional frame callback runs on the capture thread after every queued
+* frame and once when the queue is closed, so consumers can wait for frames
+* without blocking a thread.
+*/
+class CaptureThread
+{
+public:
+    typedef std::function<void()> FrameCallback;
+
+    CaptureThread(cv::VideoCapture &videoCapture, const size_t queueSize, const FrameQueue::OverflowPolicy policy,
+        FrameCallback frameCallback = FrameCallback());
+    ~CaptureThread();
+
+    bool                read(cv::Mat &frame, FrameStamp *stamp = NULL);
+    bool                tryRead(cv::Mat &frame, FrameStamp *stamp = NULL);
+    void                stop();
+    const FrameQueue&   queue() const;
+
+private:
+    cv::VideoCapture*   m_videoCapture;
+    FrameQueue          m_queue;
+    FrameCallback       m_frameCallback;
+    std::atomic<bool>   m_running;
+    uint64              m_sequence = 0;
+    std::thread         m_thread;
+
+    void    run();
+};
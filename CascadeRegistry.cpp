@@ -0,0 +1,179 @@
+#include "CascadeRegistry.h"
+#include <fstream>
+#include <sstream>
+
+SharedCascade::SharedCascade(const std::string cascadeFilePath)
+    : m_path(cascadeFilePath)
+{
+    std::ifstream file(cascadeFilePath.c_str(), std::ios::binary);
+    if (!file) return;
+
+    std::stringstream contents;
+    contents << file.rdbuf();
+    m_model = contents.str();
+
+    // Old style (opencv-haar-classifier) models can only be loaded from a file,
+    // so convert them to the current format once
+    cv::FileStorage fs(m_model, cv::FileStorage::READ | cv::FileStorage::MEMORY);
+    cv::FileNode root = fs.getFirstTopLevelNode();
+
+    // Cascades HaarEvaluator can't run are only run by CascadeClassifier
+    std::string error;
+    m_tables.read(root, error);
+
+    if (!root["stages"].empty() && root["stageType"].empty())
+        m_model = convertOldCascade(root);
+
+    // Tables that were read are a valid model, anything else is validated by
+    // building a classifier, which is then kept for the loading thread
+    if (m_tables.empty() && local()->empty())
+        m_model.clear();
+}
+
+bool SharedCascade::empty() const
+{
+    return m_model.empty();
+}
+
+const std::string &SharedCascade::path() const
+{
+    return m_path;
+}
+
+/*
+* Tables of the cascade for HaarEvaluator, NULL if it isn't a Haar cascade of
+* stumps.
+*/
+const HaarCascade *SharedCascade::haarCascade() const
+{
+    return m_tables.empty() || m_model.empty() ? NULL : &m_tables.cascade();
+}
+
+/*
+* Returns the classifier owned by the calling thread, creating it from the
+* in-memory model on first use. Only cascades without tables are run by
+* classifiers, so threads detecting Haar cascades never build one. The
+* classifiers belong to the cascade and are freed with it; a thread id reused
+* by a new thread gets the classifier of the exited one.
+*/
+cv::CascadeClassifier *SharedCascade::local() const
+{
+    std::lock_guard<std::mutex> lock(m_classifiersMutex);
+
+    std::unique_ptr<cv::CascadeClassifier> &classifier = m_classifiers[std::this_thread::get_id()];
+    if (!classifier) {
+        classifier.reset(new cv::CascadeClassifier());
+        if (!m_model.empty()) {
+            cv::FileStorage fs(m_model, cv::FileStorage::READ | cv::FileStorage::MEMORY);
+            classifier->read(fs.getFirstTopLevelNode());
+        }
+    }
+    return classifier.get();
+}
+
+/*
+* Writes an old style haar cascade in the format CascadeClassifier::read()
+* understands. Tree nodes become internal nodes, node values become leaves.
+*/
+std::string SharedCascade::convertOldCascade(const cv::FileNode &oldCascade)
+{
+    cv::FileNode sizeNode = oldCascade["size"];
+    cv::FileNode stagesNode = oldCascade["stages"];
+
+    int maxWeakCount = 0;
+    for (cv::FileNodeIterator stage = stagesNode.begin(); stage != stagesNode.end(); ++stage)
+        maxWeakCount = std::max(maxWeakCount, (int)(*stage)["trees"].size());
+
+    std::vector<cv::FileNode> features;
+
+    cv::FileStorage fs(".xml", cv::FileStorage::WRITE | cv::FileStorage::MEMORY);
+    fs << "cascade" << "{:opencv-cascade-classifier"
+        << "stageType" << "BOOST"
+        << "featureType" << "HAAR"
+        << "height" << (int)sizeNode[1]
+        << "width" << (int)sizeNode[0]
+        << "stageParams" << "{" << "maxWeakCount" << maxWeakCount << "}"
+        << "featureParams" << "{" << "maxCatCount" << 0 << "}"
+        << "stageNum" << (int)stagesNode.size()
+        << "stages" << "[";
+
+    for (cv::FileNodeIterator stage = stagesNode.begin(); stage != stagesNode.end(); ++stage) {
+        cv::FileNode trees = (*stage)["trees"];
+        fs << "{" << "maxWeakCount" << (int)trees.size()
+            << "stageThreshold" << (double)(*stage)["stage_threshold"]
+            << "weakClassifiers" << "[";
+
+        for (cv::FileNodeIterator tree = trees.begin(); tree != trees.end(); ++tree) {
+            std::vector<double> leaves;
+            fs << "{" << "internalNodes" << "[:";
+            for (cv::FileNodeIterator node = (*tree).begin(); node != (*tree).end(); ++node) {
+                int left, right;
+                if ((*node)["left_val"].empty()) {
+                    left = (int)(*node)["left_node"];
+                }
+                else {
+                    left = -(int)leaves.size();
+                    leaves.push_back((double)(*node)["left_val"]);
+                }
+                if ((*node)["right_val"].empty()) {
+                    right = (int)(*node)["right_node"];
+                }
+                else {
+                    right = -(int)leaves.size();
+                    leaves.push_back((double)(*node)["right_val"]);
+                }
+
+                fs << left << right << (int)features.size() << (double)(*node)["threshold"];
+                features.push_back((*node)["feature"]);
+            }
+            fs << "]" << "leafValues" << "[:";
+            for (double leaf : leaves)
+                fs << leaf;
+            fs << "]" << "}";
+        }
+        fs << "]" << "}";
+    }
+    fs << "]";
+
+    fs << "features" << "[";
+    for (const auto &feature : features) {
+        cv::FileNode rects = feature["rects"];
+        fs << "{" << "rects" << "[";
+        for (cv::FileNodeIterator rect = rects.begin(); rect != rects.end(); ++rect) {
+            cv::FileNode values = *rect;
+            fs << "[:" << (int)values[0] << (int)values[1] << (int)values[2] << (int)values[3]
+                << (double)values[4] << "]";
+        }
+        fs << "]";
+        if ((int)feature["tilted"] != 0)
+            fs << "tilted" << 1;
+        fs << "}";
+    }
+    fs << "]" << "}";
+
+    return fs.releaseAndGetString();
+}
+
+std::shared_ptr<SharedCascade> CascadeRegistry::acquire(const std::string cascadeFilePath)
+{
+    std::lock_guard<std::mutex> lock(mutex());
+
+    std::shared_ptr<SharedCascade> cascade = cascades()[cascadeFilePath].lock();
+    if (!cascade) {
+        cascade = std::make_shared<SharedCascade>(cascadeFilePath);
+        cascades()[cascadeFilePath] = cascade;
+    }
+    return cascade;
+}
+
+std::mutex &CascadeRegistry::mutex()
+{
+    static std::mutex registryMutex;
+    return registryMutex;
+}
+
+std::map<std::string, std::weak_ptr<SharedCascade>> &CascadeRegistry::cascades()
+{
+    static std::map<std::string, std::weak_ptr<SharedCascade>> registryCascades;
+    return registryCascades;
+}
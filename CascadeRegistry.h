@@ -0,0 +1,54 @@
+#pragma once
+
+#include <opencv2\core.hpp>
+#include <opencv2\objdetect\objdetect.hpp>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "HaarCascadeTables.h"
+
+/*
+* Cascade model loaded once and shared between detectors. Haar cascades of
+* stumps are read into HaarCascade tables once, which any number of threads
+* evaluate at once. Other cascades are run by CascadeClassifier, which can't
+* be used from several threads at once, so every thread using them gets its
+* own classifier built from the in-memory copy of the model instead of the
+* file. The model and tables are read-only after construction.
+*/
+class SharedCascade
+{
+public:
+    SharedCascade(const std::string cascadeFilePath);
+
+    bool                    empty() const;
+    const std::string&      path() const;
+    const HaarCascade*      haarCascade() const;
+    cv::CascadeClassifier*  local() const;
+
+private:
+    std::string             m_path;
+    std::string             m_model;
+    HaarCascadeTables       m_tables;
+    mutable std::mutex      m_classifiersMutex;
+    mutable std::unordered_map<std::thread::id, std::unique_ptr<cv::CascadeClassifier>> m_classifiers;
+
+    static std::string      convertOldCascade(const cv::FileNode &oldCascade);
+};
+
+/*
+* Hands out one SharedCascade per cascade file path. The model is released
+* when the last detector using it is gone.
+*/
+class CascadeRegistry
+{
+public:
+    static std::shared_ptr<SharedCascade> acquire(const std::string cascadeFilePath);
+
+private:
+    static std::mutex& mutex();
+    static std::map<std::string, std::weak_ptr<SharedCascade>>& cascades();
+};
@@ -0,0 +1,112 @@
+#include "ChangeDetector.h"
+#include <algorithm>
+#include <cstdlib>
+#include <opencv2\imgproc.hpp>
+
+ChangeDetector::ChangeDetector(uint64 *allocationCounter)
+{
+    m_cellBuffers[0] = ImageBuffer(allocationCounter);
+    m_cellBuffers[1] = ImageBuffer(allocationCounter);
+}
+
+void ChangeDetector::setCellSize(const int pixels)
+{
+    m_cellSize = std::max(pixels, 1);
+    reset();
+}
+
+int ChangeDetector::cellSize() const
+{
+    return m_cellSize;
+}
+
+void ChangeDetector::setThreshold(const int level)
+{
+    m_threshold = std::max(level, 0);
+}
+
+int ChangeDetector::threshold() const
+{
+    return m_threshold;
+}
+
+/*
+* Reduces a single channel frame to cells and compares them with the
+* reference. Returns true if any cell changed or there's no reference of the
+* same size yet, in which case the whole frame counts as changed.
+*/
+bool ChangeDetector::compare(const cv::Mat &frame)
+{
+    CV_Assert(frame.type() == CV_8UC1);
+
+    m_frameSize = frame.size();
+    cv::Size cellsSize((frame.cols + m_cellSize - 1) / m_cellSize, (frame.rows + m_cellSize - 1) / m_cellSize);
+    m_cells = m_cellBuffers[m_current].view(cellsSize, CV_8UC1);
+    cv::resize(frame, m_cells, cellsSize, 0, 0, cv::INTER_AREA);
+
+    if (m_referenceCells.empty() || m_referenceFrameSize != m_frameSize) {
+        m_changedRegion = cv::Rect(0, 0, frame.cols, frame.rows);
+        m_changedCells = cellsSize.area();
+        return true;
+    }
+
+    int left = cellsSize.width, top = cellsSize.height, right = -1, bottom = -1;
+    m_changedCells = 0;
+    for (int y = 0; y < cellsSize.height; y++) {
+        const uchar *cells = m_cells.ptr<uchar>(y);
+        const uchar *reference = m_referenceCells.ptr<uchar>(y);
+        for (int x = 0; x < cellsSize.width; x++) {
+            if (std::abs(cells[x] - reference[x]) > m_threshold) {
+                left = std::min(left, x);
+                right = std::max(right, x);
+                top = std::min(top, y);
+                bottom = std::max(bottom, y);
+                m_changedCells++;
+            }
+        }
+    }
+
+    if (m_changedCells == 0) {
+        m_changedRegion = cv::Rect();
+        return false;
+    }
+
+    m_changedRegion = cv::Rect(left * m_cellSize, top * m_cellSize,
+        (right - left + 1) * m_cellSize, (bottom - top + 1) * m_cellSize) & cv::Rect(0, 0, frame.cols, frame.rows);
+    return true;
+}
+
+/*
+* Bounding box of the changed cells of the last compare() in frame pixels.
+*/
+cv::Rect ChangeDetector::changedRegion() const
+{
+    return m_changedRegion;
+}
+
+int ChangeDetector::changedCells() const
+{
+    return m_changedCells;
+}
+
+/*
+* The frame of the last compare() becomes the reference.
+*/
+void ChangeDetector::setReference()
+{
+    if (m_cells.empty())
+        return;
+
+    m_referenceCells = m_cells;
+    m_referenceFrameSize = m_frameSize;
+    m_current ^= 1;
+    m_cells = cv::Mat();
+}
+
+void ChangeDetector::reset()
+{
+    m_cells = cv::Mat();
+    m_referenceCells = cv::Mat();
+    m_changedRegion = cv::Rect();
+    m_changedCells = 0;
+}
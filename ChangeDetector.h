@@ -0,0 +1,38 @@
+#pragma once
+
+#include <opencv2\core.hpp>
+
+#include "ImageBuffer.h"
+
+/*
+* Cheap test whether a frame differs from a reference frame. Both are reduced
+* to one mean value per cell of cellSize x cellSize pixels; cells whose mean
+* moved by more than threshold gray levels count as changed.
+*/
+class ChangeDetector
+{
+public:
+    explicit ChangeDetector(uint64 *allocationCounter = NULL);
+
+    void        setCellSize(const int pixels);
+    int         cellSize() const;
+    void        setThreshold(const int level);
+    int         threshold() const;
+    bool        compare(const cv::Mat &frame);
+    cv::Rect    changedRegion() const;
+    int         changedCells() const;
+    void        setReference();
+    void        reset();
+
+private:
+    int         m_cellSize = 8;
+    int         m_threshold = 10;
+    ImageBuffer m_cellBuffers[2];
+    int         m_current = 0;
+    cv::Mat     m_cells;
+    cv::Mat     m_referenceCells;
+    cv::Size    m_frameSize;
+    cv::Size    m_referenceFrameSize;
+    cv::Rect    m_changedRegion;
+    int         m_changedCells = 0;
+};
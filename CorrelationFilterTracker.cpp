@@ -0,0 +1,182 @@
+#include "CorrelationFilterTracker.h"
+#include <algorithm>
+#include <cmath>
+#include <opencv2\imgproc.hpp>
+
+const double CorrelationFilterTracker::LEARNING_RATE = 0.125;
+const double CorrelationFilterTracker::TARGET_SIGMA = 2;
+const double CorrelationFilterTracker::REGULARIZATION = 0.01;
+const double CorrelationFilterTracker::FULL_CONFIDENCE_PSR = 16;
+
+CorrelationFilterTracker::CorrelationFilterTracker(uint64 *allocationCounter)
+    : m_patchBuffer(allocationCounter), m_resizedPatchBuffer(allocationCounter)
+{
+    cv::createHanningWindow(m_window, cv::Size(MODEL_SIZE, MODEL_SIZE), CV_32F);
+
+    // Desired response is a gaussian peak on the face center
+    cv::Mat target(MODEL_SIZE, MODEL_SIZE, CV_32F);
+    const float center = MODEL_SIZE / 2;
+    for (int y = 0; y < MODEL_SIZE; y++) {
+        float *row = target.ptr<float>(y);
+        for (int x = 0; x < MODEL_SIZE; x++) {
+            float distance = (x - center) * (x - center) + (y - center) * (y - center);
+            row[x] = (float)std::exp(-distance / (2 * TARGET_SIGMA * TARGET_SIGMA));
+        }
+    }
+    cv::dft(target, m_targetSpectrum, cv::DFT_COMPLEX_OUTPUT);
+
+    // Model sized buffers never change size, the operations on them reuse them
+    const cv::Size modelSize(MODEL_SIZE, MODEL_SIZE);
+    m_input.create(modelSize, CV_32F);
+    m_response.create(modelSize, CV_32F);
+    m_spectrum.create(modelSize, CV_32FC2);
+    m_product.create(modelSize, CV_32FC2);
+    m_filter.create(modelSize, CV_32FC2);
+    m_numerator.create(modelSize, CV_32FC2);
+    m_denominator.create(modelSize, CV_32FC2);
+    if (allocationCounter != NULL)
+        (*allocationCounter)++;
+}
+
+/*
+* Learns a new filter from the face alone.
+*/
+void CorrelationFilterTracker::init(const cv::Mat &frame, const cv::Rect &face)
+{
+    m_faceSize = face.size();
+    sample(frame, cv::Point2f(face.x + face.width / 2.f, face.y + face.height / 2.f));
+    train(1);
+    m_trained = true;
+}
+
+/*
+* Blends the face into the filter. The model is resampled to a fixed size, so
+* a face of a different size keeps the filter learned so far.
+*/
+void CorrelationFilterTracker::refresh(const cv::Mat &frame, const cv::Rect &face)
+{
+    if (!m_trained) {
+        init(frame, face);
+        return;
+    }
+
+    m_faceSize = face.size();
+    sample(frame, cv::Point2f(face.x + face.width / 2.f, face.y + face.height / 2.f));
+    train(LEARNING_RATE);
+}
+
+/*
+* Searches a face sized window centered on the expected face, which already
+* includes motion prediction, so roi isn't needed. The face moves by the
+* offset of the response peak from the window center.
+*/
+bool CorrelationFilterTracker::update(ImagePyramid &pyramid, const cv::Rect &/*roi*/, cv::Rect &face, double &confidence)
+{
+    if (!m_trained || m_faceSize.width <= 1 || m_faceSize.height <= 1)
+        return false;
+
+    // The filter works on the full resolution frame
+    const cv::Mat &frame = pyramid.base();
+    cv::Point2f center(face.x + face.width / 2.f, face.y + face.height / 2.f);
+    sample(frame, center);
+
+    // Filter is numerator / denominator, the denominator is the real power
+    // spectrum regularized by a fraction of its mean so weak frequencies
+    // don't blow up
+    double regularization = REGULARIZATION * cv::sum(m_denominator)[0] / m_denominator.total();
+    for (int y = 0; y < m_filter.rows; y++) {
+        const cv::Vec2f *numerator = m_numerator.ptr<cv::Vec2f>(y);
+        const cv::Vec2f *denominator = m_denominator.ptr<cv::Vec2f>(y);
+        cv::Vec2f *filter = m_filter.ptr<cv::Vec2f>(y);
+        for (int x = 0; x < m_filter.cols; x++) {
+            float scale = (float)(1 / (denominator[x][0] + regularization));
+            filter[x] = cv::Vec2f(numerator[x][0] * scale, numerator[x][1] * scale);
+        }
+    }
+
+    cv::mulSpectrums(m_spectrum, m_filter, m_product, 0);
+    cv::idft(m_product, m_response, cv::DFT_SCALE | cv::DFT_REAL_OUTPUT);
+
+    double peakValue;
+    cv::Point peak;
+    cv::minMaxLoc(m_response, NULL, &peakValue, NULL, &peak);
+    confidence = std::min(1., std::max(0., peakToSidelobeRatio(peak, peakValue) / FULL_CONFIDENCE_PSR));
+
+    center.x += (peak.x - MODEL_SIZE / 2) * m_faceSize.width / (float)MODEL_SIZE;
+    center.y += (peak.y - MODEL_SIZE / 2) * m_faceSize.height / (float)MODEL_SIZE;
+    face = cv::Rect(cvRound(center.x - m_faceSize.width / 2.f), cvRound(center.y - m_faceSize.height / 2.f),
+        m_faceSize.width, m_faceSize.height) & cv::Rect(0, 0, frame.cols, frame.rows);
+    return face.width > 1 && face.height > 1;
+}
+
+const char *CorrelationFilterTracker::name() const
+{
+    return "correlation_filter";
+}
+
+/*
+* Spectrum of the face sized window around center. Pixels are log scaled to
+* even out lighting, normalized to zero mean and unit variance and tapered
+* with a cosine window so the borders don't correlate.
+*/
+void CorrelationFilterTracker::sample(const cv::Mat &frame, const cv::Point2f center)
+{
+    cv::Mat patch = m_patchBuffer.view(m_faceSize, frame.type());
+    cv::Mat resizedPatch = m_resizedPatchBuffer.view(cv::Size(MODEL_SIZE, MODEL_SIZE), frame.type());
+    cv::getRectSubPix(frame, m_faceSize, center, patch);
+    cv::resize(patch, resizedPatch, resizedPatch.size(), 0, 0, cv::INTER_AREA);
+
+    resizedPatch.convertTo(m_input, CV_32F, 1, 1);
+    cv::log(m_input, m_input);
+
+    cv::Scalar mean, deviation;
+    cv::meanStdDev(m_input, mean, deviation);
+    double scale = 1 / (deviation[0] + 1e-5);
+    m_input.convertTo(m_input, CV_32F, scale, -mean[0] * scale);
+    cv::multiply(m_input, m_window, m_input);
+
+    cv::dft(m_input, m_spectrum, cv::DFT_COMPLEX_OUTPUT);
+}
+
+/*
+* Moves numerator G F* and denominator F F* towards the last sample by rate,
+* a rate of 1 replaces them.
+*/
+void CorrelationFilterTracker::train(const double rate)
+{
+    cv::mulSpectrums(m_targetSpectrum, m_spectrum, m_product, 0, true);
+    if (rate >= 1)
+        m_product.copyTo(m_numerator);
+    else
+        cv::addWeighted(m_numerator, 1 - rate, m_product, rate, 0, m_numerator);
+
+    cv::mulSpectrums(m_spectrum, m_spectrum, m_product, 0, true);
+    if (rate >= 1)
+        m_product.copyTo(m_denominator);
+    else
+        cv::addWeighted(m_denominator, 1 - rate, m_product, rate, 0, m_denominator);
+}
+
+/*
+* Peak height over the response outside a window around the peak, in
+* standard deviations of that sidelobe.
+*/
+double CorrelationFilterTracker::peakToSidelobeRatio(const cv::Point peak, const double peakValue) const
+{
+    double sum = 0, squares = 0;
+    int count = 0;
+    for (int y = 0; y < m_response.rows; y++) {
+        const float *row = m_response.ptr<float>(y);
+        for (int x = 0; x < m_response.cols; x++) {
+            if (std::abs(x - peak.x) <= SIDELOBE_EXCLUSION && std::abs(y - peak.y) <= SIDELOBE_EXCLUSION)
+                continue;
+            sum += row[x];
+            squares += row[x] * row[x];
+            count++;
+        }
+    }
+
+    double mean = sum / count;
+    double variance = squares / count - mean * mean;
+    return variance > 0 ? (peakValue - mean) / std::sqrt(variance) : 0;
+}
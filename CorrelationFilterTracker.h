@@ -0,0 +1,50 @@
+#pragma once
+
+#include "FaceTracker.h"
+#include "ImageBuffer.h"
+
+/*
+* MOSSE correlation filter tracker (Bolme et al., "Visual Object Tracking
+* using Adaptive Correlation Filters"). The face is resampled to a fixed
+* MODEL_SIZE square, so a search costs two small FFTs whatever the face size.
+* The filter is learned in the frequency domain as a running average and
+* confidence comes from the peak to sidelobe ratio of the response. Model
+* sized buffers are allocated with the tracker and the face patch grows to
+* the biggest face seen, so tracking doesn't allocate once it has.
+*/
+class CorrelationFilterTracker : public FaceTracker
+{
+public:
+    explicit CorrelationFilterTracker(uint64 *allocationCounter = NULL);
+
+    void        init(const cv::Mat &frame, const cv::Rect &face) override;
+    void        refresh(const cv::Mat &frame, const cv::Rect &face) override;
+    bool        update(ImagePyramid &pyramid, const cv::Rect &roi, cv::Rect &face, double &confidence) override;
+    const char* name() const override;
+
+private:
+    static const int    MODEL_SIZE = 64;
+    static const int    SIDELOBE_EXCLUSION = 5;
+    static const double LEARNING_RATE;
+    static const double TARGET_SIGMA;
+    static const double REGULARIZATION;
+    static const double FULL_CONFIDENCE_PSR;
+
+    cv::Size    m_faceSize;
+    cv::Mat     m_window;
+    cv::Mat     m_targetSpectrum;
+    cv::Mat     m_numerator;
+    cv::Mat     m_denominator;
+    ImageBuffer m_patchBuffer;
+    ImageBuffer m_resizedPatchBuffer;
+    cv::Mat     m_input;
+    cv::Mat     m_spectrum;
+    cv::Mat     m_filter;
+    cv::Mat     m_product;
+    cv::Mat     m_response;
+    bool        m_trained = false;
+
+    void        sample(const cv::Mat &frame, const cv::Point2f center);
+    void        train(const double rate);
+    double      peakToSidelobeRatio(const cv::Point peak, const double peakValue) const;
+};
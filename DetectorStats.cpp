@@ -0,0 +1,308 @@
+#include "DetectorStats.h"
+#include <cmath>
+#include <sstream>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+    // Counters have a single writer, so a plain load and store is enough
+    inline void increment(std::atomic<uint64> &counter, const uint64 value = 1)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    inline int highestBit(const uint64 value)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return (int)index;
+#else
+        return 63 - __builtin_clzll(value);
+#endif
+    }
+}
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+void LatencyHistogram::record(const uint64 nanoseconds)
+{
+    increment(m_buckets[bucketIndex(nanoseconds)]);
+    increment(m_count);
+    increment(m_sum, nanoseconds);
+    if (nanoseconds > m_max.load(std::memory_order_relaxed))
+        m_max.store(nanoseconds, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::reset()
+{
+    for (auto &bucket : m_buckets)
+        bucket.store(0, std::memory_order_relaxed);
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+uint64 LatencyHistogram::count() const
+{
+    return m_count.load(std::memory_order_relaxed);
+}
+
+uint64 LatencyHistogram::sum() const
+{
+    return m_sum.load(std::memory_order_relaxed);
+}
+
+uint64 LatencyHistogram::max() const
+{
+    return m_max.load(std::memory_order_relaxed);
+}
+
+/*
+* Returns the highest value equivalent to the bucket holding the given
+* percentile, capped by the recorded maximum.
+*/
+uint64 LatencyHistogram::percentile(const double percent) const
+{
+    uint64 total = count();
+    if (total == 0)
+        return 0;
+
+    uint64 target = (uint64)std::ceil(percent / 100. * total);
+    target = std::max(target, (uint64)1);
+
+    uint64 seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if (seen >= target)
+            return std::min(bucketValue(i), max());
+    }
+    return max();
+}
+
+/*
+* Values below SUB_BUCKETS are stored exactly. Above that every power of two
+* is split into SUB_BUCKETS linear buckets.
+*/
+int LatencyHistogram::bucketIndex(uint64 value)
+{
+    if (value < SUB_BUCKETS)
+        return (int)value;
+
+    const uint64 maxValue = ((uint64)1 << MAX_VALUE_BITS) - 1;
+    value = std::min(value, maxValue);
+
+    int shift = highestBit(value) - SUB_BUCKET_BITS;
+    int subBucket = (int)((value >> shift) & (SUB_BUCKETS - 1));
+    return (shift + 1) * SUB_BUCKETS + subBucket;
+}
+
+uint64 LatencyHistogram::bucketValue(const int index)
+{
+    if (index < SUB_BUCKETS)
+        return index;
+
+    int shift = index / SUB_BUCKETS - 1;
+    int subBucket = index % SUB_BUCKETS;
+    uint64 lowest = (uint64)(SUB_BUCKETS + subBucket) << shift;
+    return lowest + ((uint64)1 << shift) - 1;
+}
+
+DetectorStats::DetectorStats()
+{
+    for (auto &frames : m_frames)
+        frames.store(0, std::memory_order_relaxed);
+    for (auto &scans : m_scans)
+        scans.store(0, std::memory_order_relaxed);
+}
+
+void DetectorStats::recordStage(const Stage stage, const uint64 nanoseconds)
+{
+    m_stages[stage].record(nanoseconds);
+}
+
+/*
+* Records the span of a stage of frame, and adds it to the trace log if set.
+*/
+void DetectorStats::recordSpan(const Stage stage, const std::chrono::steady_clock::time_point start,
+    const std::chrono::steady_clock::time_point end, const uint64 frame)
+{
+    m_stages[stage].record((uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    if (m_trace != NULL)
+        m_trace->add(stageName(stage), m_traceTrack, frame, start, end);
+}
+
+void DetectorStats::recordFrame(const TrackingState state)
+{
+    increment(m_frames[state]);
+}
+
+void DetectorStats::recordScanGate(const ScanGate gate)
+{
+    increment(m_scans[gate]);
+}
+
+void DetectorStats::reset()
+{
+    for (auto &stage : m_stages)
+        stage.reset();
+    for (auto &frames : m_frames)
+        frames.store(0, std::memory_order_relaxed);
+    for (auto &scans : m_scans)
+        scans.store(0, std::memory_order_relaxed);
+}
+
+const LatencyHistogram &DetectorStats::stage(const Stage stage) const
+{
+    return m_stages[stage];
+}
+
+uint64 DetectorStats::frames(const TrackingState state) const
+{
+    return m_frames[state].load(std::memory_order_relaxed);
+}
+
+uint64 DetectorStats::frames() const
+{
+    uint64 total = 0;
+    for (int i = 0; i < TRACKING_STATE_COUNT; i++)
+        total += frames((TrackingState)i);
+    return total;
+}
+
+uint64 DetectorStats::scans(const ScanGate gate) const
+{
+    return m_scans[gate].load(std::memory_order_relaxed);
+}
+
+/*
+* Latencies are reported in microseconds.
+*/
+std::string DetectorStats::toJson() const
+{
+    std::ostringstream json;
+    json << "{\"frames\":" << frames() << ",\"states\":{";
+    for (int i = 0; i < TRACKING_STATE_COUNT; i++) {
+        json << (i ? "," : "") << "\"" << stateName((TrackingState)i) << "\":" << frames((TrackingState)i);
+    }
+    json << "},\"scan_gate\":{";
+    for (int i = 0; i < SCAN_GATE_COUNT; i++) {
+        json << (i ? "," : "") << "\"" << gateName((ScanGate)i) << "\":" << scans((ScanGate)i);
+    }
+    json << "},\"stages\":{";
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        const LatencyHistogram &histogram = m_stages[i];
+        double mean = histogram.count() ? (double)histogram.sum() / histogram.count() : 0;
+        json << (i ? "," : "") << "\"" << stageName((Stage)i) << "\":{"
+            << "\"count\":" << histogram.count()
+            << ",\"mean_us\":" << mean / 1e3
+            << ",\"p50_us\":" << histogram.percentile(50) / 1e3
+            << ",\"p99_us\":" << histogram.percentile(99) / 1e3
+            << ",\"max_us\":" << histogram.max() / 1e3 << "}";
+    }
+    json << "}}";
+    return json.str();
+}
+
+/*
+* Prometheus text exposition format. labels are added to every sample,
+* e.g. "stream=\"lobby\"".
+*/
+std::string DetectorStats::toPrometheus(const std::string &labels) const
+{
+    std::string extra = labels.empty() ? std::string() : "," + labels;
+    std::ostringstream text;
+
+    text << "# HELP face_detector_stage_seconds Latency of detector stages.\n"
+        << "# TYPE face_detector_stage_seconds summary\n";
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        const LatencyHistogram &histogram = m_stages[i];
+        std::string stage = std::string("stage=\"") + stageName((Stage)i) + "\"" + extra;
+        text << "face_detector_stage_seconds{" << stage << ",quantile=\"0.5\"} " << histogram.percentile(50) / 1e9 << "\n"
+            << "face_detector_stage_seconds{" << stage << ",quantile=\"0.99\"} " << histogram.percentile(99) / 1e9 << "\n"
+            << "face_detector_stage_seconds{" << stage << ",quantile=\"1\"} " << histogram.max() / 1e9 << "\n"
+            << "face_detector_stage_seconds_sum{" << stage << "} " << histogram.sum() / 1e9 << "\n"
+            << "face_detector_stage_seconds_count{" << stage << "} " << histogram.count() << "\n";
+    }
+
+    text << "# HELP face_detector_frames_total Frames processed in each tracking state.\n"
+        << "# TYPE face_detector_frames_total counter\n";
+    for (int i = 0; i < TRACKING_STATE_COUNT; i++) {
+        text << "face_detector_frames_total{state=\"" << stateName((TrackingState)i) << "\"" << extra << "} "
+            << frames((TrackingState)i) << "\n";
+    }
+
+    text << "# HELP face_detector_scans_total Full frame scans by outcome of the change detection gate.\n"
+        << "# TYPE face_detector_scans_total counter\n";
+    for (int i = 0; i < SCAN_GATE_COUNT; i++) {
+        text << "face_detector_scans_total{result=\"" << gateName((ScanGate)i) << "\"" << extra << "} "
+            << scans((ScanGate)i) << "\n";
+    }
+    return text.str();
+}
+
+/*
+* Adds the spans of all stages to trace, on the row of track. The log is not
+* owned and must outlive the stats or be unset with NULL.
+*/
+void DetectorStats::setTrace(TraceLog *trace, const int track)
+{
+    m_trace = trace;
+    m_traceTrack = track;
+}
+
+TraceLog *DetectorStats::trace() const
+{
+    return m_trace;
+}
+
+const char *DetectorStats::stageName(const Stage stage)
+{
+    switch (stage) {
+    case Capture:               return "capture";
+    case Resize:                return "resize";
+    case DetectAllSizes:        return "detect_all_sizes";
+    case DetectAroundRoi:       return "detect_around_roi";
+    case TemplateMatchingStage: return "template_matching";
+    case ChangeDetection:       return "change_detection";
+    case Frame:                 return "frame";
+    case CaptureToResult:       return "capture_to_result";
+    default:                    return "unknown";
+    }
+}
+
+const char *DetectorStats::stateName(const TrackingState state)
+{
+    switch (state) {
+    case FullFrameDetection:    return "full_frame";
+    case RoiDetection:          return "roi";
+    case TemplateMatching:      return "template_matching";
+    default:                    return "unknown";
+    }
+}
+
+const char *DetectorStats::gateName(const ScanGate gate)
+{
+    switch (gate) {
+    case ScanSkipped:           return "skipped";
+    case ScanPartial:           return "partial";
+    case ScanFull:              return "full";
+    default:                    return "unknown";
+    }
+}
+
+ScopedStageTimer::ScopedStageTimer(DetectorStats &stats, const DetectorStats::Stage stage, const uint64 frame)
+    : m_stats(stats), m_stage(stage), m_frame(frame), m_start(std::chrono::steady_clock::now())
+{
+}
+
+ScopedStageTimer::~ScopedStageTimer()
+{
+    m_stats.recordSpan(m_stage, m_start, std::chrono::steady_clock::now(), m_frame);
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <opencv2\core.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#include "TraceLog.h"
+
+enum TrackingState
+{
+    FullFrameDetection,     // No face tracked, cascade runs over the whole frame
+    RoiDetection,           // Every face found by cascade in its ROI
+    TemplateMatching,       // At least one face tracked by template matching
+    TRACKING_STATE_COUNT
+};
+
+/*
+* Log-linear latency histogram in the style of HdrHistogram. Values are kept
+* with 16 sub-buckets per power of two, so percentiles are within ~6% of the
+* recorded value. Written by a single thread, safe to read from any thread.
+*/
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void    record(const uint64 nanoseconds);
+    void    reset();
+    uint64  count() const;
+    uint64  sum() const;
+    uint64  max() const;
+    uint64  percentile(const double percent) const;
+
+private:
+    static const int    SUB_BUCKET_BITS = 4;
+    static const int    SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const int    MAX_VALUE_BITS = 44;
+    static const int    BUCKET_COUNT = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    std::atomic<uint64> m_buckets[BUCKET_COUNT];
+    std::atomic<uint64> m_count;
+    std::atomic<uint64> m_sum;
+    std::atomic<uint64> m_max;
+
+    static int      bucketIndex(uint64 value);
+    static uint64   bucketValue(const int index);
+};
+
+/*
+* Per-stage latencies, per-state frame counters and scan gate counters of a
+* VideoFaceDetector. With a trace log set every stage sample is also added to
+* it as a span.
+*/
+class DetectorStats
+{
+public:
+    enum Stage
+    {
+        Capture,
+        Resize,
+        DetectAllSizes,
+        DetectAroundRoi,
+        TemplateMatchingStage,
+        ChangeDetection,
+        Frame,
+        CaptureToResult,
+        STAGE_COUNT
+    };
+
+    // Outcome of the change detection gate in front of a full frame scan
+    enum ScanGate
+    {
+        ScanSkipped,
+        ScanPartial,
+        ScanFull,
+        SCAN_GATE_COUNT
+    };
+
+    DetectorStats();
+
+    void                        recordStage(const Stage stage, const uint64 nanoseconds);
+    void                        recordSpan(const Stage stage, const std::chrono::steady_clock::time_point start,
+                                    const std::chrono::steady_clock::time_point end, const uint64 frame);
+    void                        recordFrame(const TrackingState state);
+    void                        recordScanGate(const ScanGate gate);
+    void                        reset();
+    const LatencyHistogram&     stage(const Stage stage) const;
+    uint64                      frames(const TrackingState state) const;
+    uint64                      frames() const;
+    uint64                      scans(const ScanGate gate) const;
+    std::string                 toJson() const;
+    std::string                 toPrometheus(const std::string &labels = std::string()) const;
+    void                        setTrace(TraceLog *trace, const int track = 0);
+    TraceLog*                   trace() const;
+
+    static const char*          stageName(const Stage stage);
+    static const char*          stateName(const TrackingState state);
+    static const char*          gateName(const ScanGate gate);
+
+private:
+    LatencyHistogram            m_stages[STAGE_COUNT];
+    std::atomic<uint64>         m_frames[TRACKING_STATE_COUNT];
+    std::atomic<uint64>         m_scans[SCAN_GATE_COUNT];
+    TraceLog*                   m_trace = NULL;
+    int                         m_traceTrack = 0;
+};
+
+/*
+* Records the time between construction and destruction as one sample of a
+* stage of frame.
+*/
+class ScopedStageTimer
+{
+public:
+    ScopedStageTimer(DetectorStats &stats, const DetectorStats::Stage stage, const uint64 frame = 0);
+    ~ScopedStageTimer();
+
+private:
+    DetectorStats&                          m_stats;
+    DetectorStats::Stage                    m_stage;
+    uint64                                  m_frame;
+    std::chrono::steady_clock::time_point   m_start;
+};
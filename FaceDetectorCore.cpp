@@ -0,0 +1,972 @@
+#include "FaceDetectorCore.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <thread>
+#include <opencv2\imgproc.hpp>
+
+namespace
+{
+    // Overlap a detection needs with a track to be taken as its face
+    const double MIN_MATCH_IOU = 0.3;
+
+    // Grouping of cv::CascadeClassifier::detectMultiScale
+    const int       MIN_NEIGHBORS = 3;
+    const double    GROUP_EPS = 0.2;
+
+    // cv::SimilarRects, faces whose edges are within GROUP_EPS of their size
+    bool similarFaces(const cv::Rect &a, const cv::Rect &b)
+    {
+        double delta = GROUP_EPS * (std::min(a.width, b.width) + std::min(a.height, b.height)) * 0.5;
+        return std::abs(a.x - b.x) <= delta && std::abs(a.y - b.y) <= delta &&
+            std::abs(a.x + a.width - b.x - b.width) <= delta && std::abs(a.y + a.height - b.y - b.height) <= delta;
+    }
+
+    // Root of index in a forest where parents come before their children,
+    // so a root is the first face of its group
+    int groupRoot(std::vector<int> &parents, int index)
+    {
+        while (parents[index] != index) {
+            parents[index] = parents[parents[index]];
+            index = parents[index];
+        }
+        return index;
+    }
+
+    // Pool used by parallel full frame scans of streams not given one
+    ThreadPool &sharedScanPool()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+}
+
+FaceDetectorCore::FaceDetectorCore(const std::string cascadeFilePath)
+    : m_faceCascade(CascadeRegistry::acquire(cascadeFilePath))
+{
+    if (m_faceCascade->empty()) {
+        std::cerr << "Error creating cascade classifier. Make sure the file" << std::endl
+            << cascadeFilePath << " exists." << std::endl;
+    }
+}
+
+bool FaceDetectorCore::empty() const
+{
+    return m_faceCascade->empty();
+}
+
+const std::string &FaceDetectorCore::cascadeFilePath() const
+{
+    return m_faceCascade->path();
+}
+
+/*
+* Returns the calling thread's instance of the shared cascade.
+*/
+cv::CascadeClassifier *FaceDetectorCore::faceCascade() const
+{
+    return m_faceCascade->local();
+}
+
+/*
+* True if full frame scans of state can be split over several tasks, which
+* takes a cascade run by HaarEvaluator. Other cascades run detectMultiScale
+* on the calling thread whatever the scan concurrency.
+*/
+bool FaceDetectorCore::splitsScans(const TrackerState &state) const
+{
+    return state.cascadeBackend == CascadeBackendCompiled || m_faceCascade->haarCascade() != NULL;
+}
+
+/*
+* Prepares state for full frame scans split into up to tasks at once.
+*/
+void FaceDetectorCore::setScanConcurrency(TrackerState &state, const int tasks, ThreadPool *pool)
+{
+    state.scanConcurrency = std::max(tasks, 1);
+    state.scanPool = pool;
+
+    while ((int)state.scan->slots.size() < state.scanConcurrency) {
+        std::unique_ptr<TrackerState::ScanSlot> slot(new TrackerState::ScanSlot());
+        slot->evaluator.reset(new HaarEvaluator(HaarEvaluator::frontalFace(), &slot->allocations));
+        state.scan->slots.push_back(std::move(slot));
+    }
+}
+
+cv::Rect FaceDetectorCore::doubleRectSize(const cv::Rect &inputRect, const cv::Rect &frameSize) const
+{
+    cv::Rect outputRect;
+    // Double rect size
+    outputRect.width = inputRect.width * 2;
+    outputRect.height = inputRect.height * 2;
+
+    // Center rect around original center
+    outputRect.x = inputRect.x - inputRect.width / 2;
+    outputRect.y = inputRect.y - inputRect.height / 2;
+
+    // Handle edge cases
+    if (outputRect.x < frameSize.x) {
+        outputRect.width += outputRect.x;
+        outputRect.x = frameSize.x;
+    }
+    if (outputRect.y < frameSize.y) {
+        outputRect.height += outputRect.y;
+        outputRect.y = frameSize.y;
+    }
+
+    if (outputRect.x + outputRect.width > frameSize.width) {
+        outputRect.width = frameSize.width - outputRect.x;
+    }
+    if (outputRect.y + outputRect.height > frameSize.height) {
+        outputRect.height = frameSize.height - outputRect.y;
+    }
+
+    return outputRect;
+}
+
+/*
+* Search window around the predicted face center. It leaves room for the face
+* growing by 20% plus three standard deviations of the predicted position,
+* and never exceeds three times the face size.
+*/
+cv::Rect FaceDetectorCore::predictedRoi(const Track &track, const cv::Rect &frameSize) const
+{
+    cv::Point2f center = track.motion.predictedCenter();
+    cv::Size2f sigma = track.motion.uncertainty();
+
+    float width = std::min(track.face.width * 1.25f + 6 * sigma.width, track.face.width * 3.f);
+    float height = std::min(track.face.height * 1.25f + 6 * sigma.height, track.face.height * 3.f);
+
+    cv::Rect roi((int)(center.x - width / 2), (int)(center.y - height / 2), (int)width, (int)height);
+    return roi & frameSize;
+}
+
+cv::Point FaceDetectorCore::centerOfRect(const cv::Rect &rect) const
+{
+    return cv::Point(rect.x + rect.width / 2, rect.y + rect.height / 2);
+}
+
+cv::Rect FaceDetectorCore::biggestFace(std::vector<cv::Rect> &faces) const
+{
+    assert(!faces.empty());
+
+    cv::Rect *biggest = &faces[0];
+    for (auto &face : faces) {
+        if (face.area() > biggest->area())
+            biggest = &face;
+    }
+    return *biggest;
+}
+
+/*
+* Two faces are considered the same if their intersection covers
+* at least a third of the smaller one.
+*/
+bool FaceDetectorCore::facesOverlap(const cv::Rect &a, const cv::Rect &b) const
+{
+    int intersection = (a & b).area();
+    return intersection * 3 >= std::min(a.area(), b.area());
+}
+
+double FaceDetectorCore::intersectionOverUnion(const cv::Rect &a, const cv::Rect &b) const
+{
+    int intersection = (a & b).area();
+    int area = a.area() + b.area() - intersection;
+    return area > 0 ? (double)intersection / area : 0;
+}
+
+bool FaceDetectorCore::overlapsTrack(const TrackerState &state, const cv::Rect &rect) const
+{
+    for (const auto &track : state.tracks) {
+        if (!track.lost && facesOverlap(rect, track.face))
+            return true;
+    }
+    return false;
+}
+
+void FaceDetectorCore::startTrack(TrackerState &state, const cv::Mat &frame, const cv::Rect &face) const
+{
+    Track track;
+    track.id = state.nextTrackId++;
+
+    // Reuse tracker and motion model of a dropped track
+    if (state.freeTrackers.empty()) {
+        track.tracker = FaceTracker::create(state.trackerBackend, state.allocations.get());
+    }
+    else {
+        track.tracker = std::move(state.freeTrackers.back());
+        state.freeTrackers.pop_back();
+    }
+    if (state.freeMotionModels.empty()) {
+        track.motion = MotionModel(state.allocations.get());
+    }
+    else {
+        track.motion = std::move(state.freeMotionModels.back());
+        state.freeMotionModels.pop_back();
+    }
+    track.motion.init(centerOfRect(face));
+
+    track.tracker->init(frame, face);
+    updateTrack(frame, track, face, false);
+    state.tracks.push_back(std::move(track));
+}
+
+void FaceDetectorCore::updateTrack(const cv::Mat &frame, Track &track, const cv::Rect &face, const bool refreshTracker) const
+{
+    track.face = face;
+
+    // Adapt tracker to the face
+    if (refreshTracker)
+        track.tracker->refresh(frame, track.face);
+
+    // Calculate roi
+    track.roi = doubleRectSize(track.face, cv::Rect(0, 0, frame.cols, frame.rows));
+
+    // Update face position
+    track.position = centerOfRect(track.face);
+    track.motion.correct(track.position);
+}
+
+/*
+* Drops tracks that lost their face and tracks that drifted onto a face
+* which is already tracked by an older track.
+*/
+void FaceDetectorCore::removeLostTracks(TrackerState &state) const
+{
+    for (size_t i = 1; i < state.tracks.size(); i++) {
+        for (size_t j = 0; j < i && !state.tracks[i].lost; j++) {
+            if (!state.tracks[j].lost && facesOverlap(state.tracks[i].face, state.tracks[j].face))
+                state.tracks[i].lost = true;
+        }
+    }
+
+    for (auto &track : state.tracks) {
+        if (!track.lost)
+            continue;
+        if (track.tracker)
+            state.freeTrackers.push_back(std::move(track.tracker));
+        state.freeMotionModels.push_back(std::move(track.motion));
+    }
+
+    state.tracks.erase(std::remove_if(state.tracks.begin(), state.tracks.end(),
+        [](const Track &track) { return track.lost; }), state.tracks.end());
+}
+
+/*
+* Moves tracks to a frame resized by factor. Trackers restart on the new
+* frame and the cascade confirms every face on the next search.
+*/
+void FaceDetectorCore::rescaleTracks(TrackerState &state, const cv::Mat &frame, const double factor) const
+{
+    cv::Rect frameRect(0, 0, frame.cols, frame.rows);
+    for (auto &track : state.tracks) {
+        track.face = cv::Rect(cvRound(track.face.x * factor), cvRound(track.face.y * factor),
+            cvRound(track.face.width * factor), cvRound(track.face.height * factor)) & frameRect;
+        if (track.face.width <= 1 || track.face.height <= 1) {
+            track.lost = true;
+            continue;
+        }
+
+        track.roi = doubleRectSize(track.face, frameRect);
+        track.position = centerOfRect(track.face);
+        track.motion.rescale((float)factor);
+        track.tracker->init(frame, track.face);
+        track.confidence = 0;
+    }
+    removeLostTracks(state);
+}
+
+/*
+* Runs the cascade over region of the frame and stores faces sized between
+* minSize and maxSize in state.allFaces, in frame coordinates. Haar cascades
+* run on HaarEvaluator over the shared pyramid with the scales, window steps,
+* scoring and grouping of detectMultiScale on the region, so they find the
+* same faces it does. Other cascades of the OpenCV backend run
+* detectMultiScale itself.
+*/
+void FaceDetectorCore::detectFaces(TrackerState &state, const cv::Mat &frame, const cv::Rect &region, const cv::Size minSize, const cv::Size maxSize) const
+{
+    bool compiled = state.cascadeBackend == CascadeBackendCompiled;
+    const HaarCascade *haarCascade = compiled ? &HaarEvaluator::frontalFace() : m_faceCascade->haarCascade();
+    bool masked = !state.searchMask.empty();
+
+    // Windows lie inside region, so none is centered in the search area if region misses it
+    if (masked && (region & state.searchMask.bounds()).area() == 0) {
+        state.allFaces.clear();
+        return;
+    }
+
+    if (haarCascade == NULL) {
+        // Only the part of region faces centered in the search area can reach
+        cv::Rect searchRegion = region;
+        if (masked) {
+            cv::Rect bounds = state.searchMask.bounds();
+            searchRegion &= cv::Rect(bounds.x - maxSize.width / 2, bounds.y - maxSize.height / 2,
+                bounds.width + maxSize.width, bounds.height + maxSize.height);
+        }
+
+        state.allFaces.clear();
+        if (searchRegion.width >= minSize.width && searchRegion.height >= minSize.height) {
+            m_faceCascade->local()->detectMultiScale(frame(searchRegion), state.allFaces, state.pyramid.scaleFactor(),
+                MIN_NEIGHBORS, 0, minSize, maxSize);
+        }
+        for (auto &face : state.allFaces) {
+            face.x += searchRegion.x;
+            face.y += searchRegion.y;
+        }
+        if (masked)
+            removeMaskedFaces(state);
+        return;
+    }
+
+    state.haarEvaluator.setCascade(*haarCascade);
+
+    bool fullFrame = region == cv::Rect(0, 0, frame.cols, frame.rows);
+    if (fullFrame && state.scanConcurrency > 1) {
+        detectFacesParallel(state, frame, *haarCascade, minSize, maxSize);
+        return;
+    }
+
+    // Faces are collected relative to the region and grouped there, like detectMultiScale does
+    cv::Rect baseRect = region;
+    state.allFaces.clear();
+    for (int level = 0; ; level++) {
+        double scale = state.pyramid.levelScale(level);
+        cv::Size faceSize(cvRound(haarCascade->width * scale), cvRound(haarCascade->height * scale));
+        if (faceSize.width > maxSize.width || faceSize.height > maxSize.height
+            || faceSize.width > region.width || faceSize.height > region.height) break;
+        if (faceSize.width < minSize.width || faceSize.height < minSize.height) continue;
+
+        // Full frame search builds whole levels, ROI search only its region
+        cv::Mat image = fullFrame ? state.pyramid.level(level) : state.pyramid.region(level, region, baseRect);
+
+        cv::Mat mask;
+        if (masked)
+            mask = fullFrame ? state.searchMask.level(level, image.size()) : state.searchMask.region(baseRect, image.size());
+        scanImage(image, mask, scanStep((float)scale), state.haarEvaluator, state.levelFaces);
+
+        for (const auto &face : state.levelFaces)
+            state.allFaces.push_back(state.pyramid.toBase(level, face));
+    }
+
+    groupFaces(state);
+    for (auto &face : state.allFaces) {
+        face.x += baseRect.x;
+        face.y += baseRect.y;
+    }
+    if (masked)
+        removeMaskedFaces(state);
+}
+
+/*
+* Window step of detectMultiScale on a level downscaled by scale.
+*/
+int FaceDetectorCore::scanStep(const double scale) const
+{
+    return scale >= 2 ? 1 : 2;
+}
+
+/*
+* Runs the evaluator over image every step pixels and stores the accepted
+* windows in faces. With a mask of the image size only windows centered in
+* it are searched: the image is cropped to them on the step grid and the
+* evaluator skips the others in the crop.
+*/
+void FaceDetectorCore::scanImage(const cv::Mat &image, const cv::Mat &mask, const int step, HaarEvaluator &evaluator,
+    std::vector<cv::Rect> &faces) const
+{
+    cv::Rect crop = scanCrop(image, mask, evaluator.windowSize());
+    if (crop.area() == 0) {
+        faces.clear();
+        return;
+    }
+
+    evaluator.detect(image(crop), faces, step, mask.empty() ? cv::Mat() : mask(crop));
+    for (auto &face : faces) {
+        face.x += crop.x;
+        face.y += crop.y;
+    }
+}
+
+/*
+* Part of image holding the windows centered in mask, or all of it without
+* mask. It starts on even coordinates, so scanning it keeps the scan grid.
+*/
+cv::Rect FaceDetectorCore::scanCrop(const cv::Mat &image, const cv::Mat &mask, const cv::Size windowSize) const
+{
+    if (image.cols < windowSize.width || image.rows < windowSize.height)
+        return cv::Rect();
+    if (mask.empty())
+        return cv::Rect(0, 0, image.cols, image.rows);
+
+    cv::Rect origins = SearchMask::windowOrigins(mask,
+        cv::Rect(0, 0, image.cols - windowSize.width + 1, image.rows - windowSize.height + 1), windowSize);
+    if (origins.area() == 0)
+        return cv::Rect();
+    return cv::Rect(origins.x, origins.y, origins.width + windowSize.width - 1, origins.height + windowSize.height - 1);
+}
+
+/*
+* Drops faces of state.allFaces centered outside the search area.
+*/
+void FaceDetectorCore::removeMaskedFaces(TrackerState &state) const
+{
+    state.allFaces.erase(std::remove_if(state.allFaces.begin(), state.allFaces.end(),
+        [this, &state](const cv::Rect &face) { return !state.searchMask.contains(centerOfRect(face)); }),
+        state.allFaces.end());
+}
+
+/*
+* Full frame scan over the shared pyramid split into jobs of bands of window
+* rows. Levels and their integrals are built up front, the jobs are then
+* taken in order by state.scanConcurrency tasks. Every window belongs to
+* exactly one band and results are merged in job order, so grouping sees the
+* same faces in the same order as a sequential scan.
+*/
+void FaceDetectorCore::detectFacesParallel(TrackerState &state, const cv::Mat &frame, const HaarCascade &cascade,
+    const cv::Size minSize, const cv::Size maxSize) const
+{
+    bool masked = !state.searchMask.empty();
+    cv::Size windowSize(cascade.width, cascade.height);
+
+    // Bands are an even number of rows so they keep the scan grid
+    const int bandRows = windowSize.height * 2;
+
+    size_t jobCount = 0;
+    for (int level = 0; ; level++) {
+        double scale = state.pyramid.levelScale(level);
+        cv::Size faceSize(cvRound(windowSize.width * scale), cvRound(windowSize.height * scale));
+        if (faceSize.width > maxSize.width || faceSize.height > maxSize.height
+            || faceSize.width > frame.cols || faceSize.height > frame.rows) break;
+        if (faceSize.width < minSize.width || faceSize.height < minSize.height) continue;
+
+        // Level masks are built up front too, tasks only read them
+        const cv::Mat &image = state.pyramid.level(level);
+        cv::Mat mask;
+        if (masked)
+            mask = state.searchMask.level(level, image.size());
+
+        cv::Rect crop = scanCrop(image, mask, windowSize);
+        if (crop.area() == 0) continue;
+
+        if ((int)state.scan->integralBuffers.size() <= level)
+            state.scan->integralBuffers.resize(level + 1, ImageBuffer(state.allocations.get()));
+        cv::Size integralSize(crop.width + 1, crop.height + 1);
+        cv::Mat integrals = state.scan->integralBuffers[level].view(
+            cv::Size(integralSize.width, 2 * integralSize.height), CV_32SC1);
+        cv::Mat sum = integrals.rowRange(0, integralSize.height);
+        cv::Mat squareSum = integrals.rowRange(integralSize.height, 2 * integralSize.height);
+        HaarEvaluator::integrate(image(crop), sum, squareSum);
+
+        int windowRows = crop.height - windowSize.height + 1;
+        for (int firstRow = 0; firstRow < windowRows; firstRow += bandRows) {
+            if (state.scan->jobs.size() <= jobCount)
+                state.scan->jobs.emplace_back();
+            ScanJob &job = state.scan->jobs[jobCount++];
+            job.level = level;
+            job.sum = sum;
+            job.squareSum = squareSum;
+            job.mask = mask.empty() ? cv::Mat() : mask(crop);
+            job.origin = crop.tl();
+            job.firstRow = firstRow;
+            job.endRow = std::min(firstRow + bandRows, windowRows);
+            job.faces.clear();
+        }
+    }
+
+    state.scan->jobs.resize(jobCount);
+    for (auto &slot : state.scan->slots)
+        slot->evaluator->setCascade(cascade);
+
+    ThreadPool &pool = state.scanPool != NULL ? *state.scanPool : sharedScanPool();
+    int helpers = (int)std::min((size_t)state.scanConcurrency, jobCount) - 1;
+
+    state.scan->nextJob = 0;
+    state.scan->runningTasks = std::max(helpers, 0);
+    for (int slot = 1; slot <= helpers; slot++) {
+        pool.submit([this, &state, slot] {
+            runScanJobs(state, slot);
+            state.scan->runningTasks--;
+        });
+    }
+    runScanJobs(state, 0);
+
+    // Help with queued tasks instead of blocking, the helpers may be queued behind them
+    while (state.scan->runningTasks > 0) {
+        if (!pool.runPendingTask())
+            std::this_thread::yield();
+    }
+
+    state.allFaces.clear();
+    for (auto &job : state.scan->jobs) {
+        for (const auto &face : job.faces)
+            state.allFaces.push_back(state.pyramid.toBase(job.level, face));
+        job.sum.release();
+        job.squareSum.release();
+        job.mask.release();
+    }
+
+    groupFaces(state);
+    if (masked)
+        removeMaskedFaces(state);
+}
+
+/*
+* cv::groupRectangles(state.allFaces, MIN_NEIGHBORS, GROUP_EPS) in buffers
+* of state, so grouping doesn't allocate once they have grown. Similar faces
+* are joined into groups, groups of more than MIN_NEIGHBORS faces are
+* averaged and a group inside a stronger one is dropped. Groups come out in
+* the order of their first face, like cv::partition() numbers them.
+*/
+void FaceDetectorCore::groupFaces(TrackerState &state) const
+{
+    std::vector<cv::Rect> &faces = state.allFaces;
+    int count = (int)faces.size();
+    state.groupParents.resize(count);
+    state.groupRects.assign(count, cv::Rect());
+    state.groupSizes.assign(count, 0);
+
+    for (int i = 0; i < count; i++) {
+        state.groupParents[i] = i;
+        for (int j = 0; j < i; j++) {
+            if (!similarFaces(faces[i], faces[j]))
+                continue;
+            int a = groupRoot(state.groupParents, i);
+            int b = groupRoot(state.groupParents, j);
+            state.groupParents[std::max(a, b)] = std::min(a, b);
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        int root = groupRoot(state.groupParents, i);
+        cv::Rect &sum = state.groupRects[root];
+        sum.x += faces[i].x;
+        sum.y += faces[i].y;
+        sum.width += faces[i].width;
+        sum.height += faces[i].height;
+        state.groupSizes[root]++;
+    }
+    for (int i = 0; i < count; i++) {
+        if (state.groupSizes[i] == 0)
+            continue;
+        cv::Rect &rect = state.groupRects[i];
+        float scale = 1.f / state.groupSizes[i];
+        rect = cv::Rect(cv::saturate_cast<int>(rect.x * scale), cv::saturate_cast<int>(rect.y * scale),
+            cv::saturate_cast<int>(rect.width * scale), cv::saturate_cast<int>(rect.height * scale));
+    }
+
+    // Faces are read back from the group rects, so allFaces can be refilled
+    faces.clear();
+    for (int i = 0; i < count; i++) {
+        int size = state.groupSizes[i];
+        if (size <= MIN_NEIGHBORS)
+            continue;
+
+        const cv::Rect &rect = state.groupRects[i];
+        bool inside = false;
+        for (int j = 0; j < count && !inside; j++) {
+            int otherSize = state.groupSizes[j];
+            if (j == i || otherSize <= MIN_NEIGHBORS)
+                continue;
+            const cv::Rect &other = state.groupRects[j];
+            int dx = cv::saturate_cast<int>(other.width * GROUP_EPS);
+            int dy = cv::saturate_cast<int>(other.height * GROUP_EPS);
+            inside = rect.x >= other.x - dx && rect.y >= other.y - dy &&
+                rect.x + rect.width <= other.x + other.width + dx &&
+                rect.y + rect.height <= other.y + other.height + dy &&
+                (otherSize > std::max(3, size) || size < 3);
+        }
+        if (!inside)
+            faces.push_back(rect);
+    }
+}
+
+/*
+* Scans jobs until none are left, each over the rows of its band of the
+* shared level integrals.
+*/
+void FaceDetectorCore::runScanJobs(TrackerState &state, const int slot) const
+{
+    HaarEvaluator &evaluator = *state.scan->slots[slot]->evaluator;
+
+    for (;;) {
+        size_t index = state.scan->nextJob++;
+        if (index >= state.scan->jobs.size())
+            return;
+
+        ScanJob &job = state.scan->jobs[index];
+        evaluator.detect(job.sum, job.squareSum, job.firstRow, job.endRow, job.faces,
+            scanStep((float)state.pyramid.levelScale(job.level)), job.mask);
+
+        for (auto &face : job.faces) {
+            face.x += job.origin.x;
+            face.y += job.origin.y;
+        }
+    }
+}
+
+/*
+* Decides if a frame without tracked faces is scanned and where. Returns false
+* to skip the scan, otherwise region is the whole frame or the changed area
+* grown by half the biggest face size.
+*/
+bool FaceDetectorCore::gateFullFrameScan(TrackerState &state, const cv::Mat &frame, cv::Rect &region) const
+{
+    cv::Rect frameRect(0, 0, frame.cols, frame.rows);
+    region = frameRect;
+    if (!state.changeGate || state.forceTrackingState) return true;
+
+    bool changed;
+    {
+        ScopedStageTimer timer(*state.stats, DetectorStats::ChangeDetection, state.frameStamp.sequence);
+        changed = state.changeDetector.compare(frame);
+    }
+
+    if (!changed && state.skippedScans < state.maxSkippedScans) {
+        state.skippedScans++;
+        state.stats->recordScanGate(DetectorStats::ScanSkipped);
+        return false;
+    }
+
+    state.skippedScans = 0;
+    state.changeDetector.setReference();
+
+    if (changed) {
+        int margin = frame.rows / 3;
+        cv::Rect changedRegion = state.changeDetector.changedRegion();
+        region = cv::Rect(changedRegion.x - margin, changedRegion.y - margin,
+            changedRegion.width + 2 * margin, changedRegion.height + 2 * margin) & frameRect;
+    }
+
+    // Region scans cost pyramid level crops, not worth it for most of the frame
+    if (region.area() * 4 >= frameRect.area() * 3) {
+        region = frameRect;
+        state.stats->recordScanGate(DetectorStats::ScanFull);
+    } else {
+        state.stats->recordScanGate(DetectorStats::ScanPartial);
+    }
+    return true;
+}
+
+void FaceDetectorCore::detectFaceAllSizes(TrackerState &state, const cv::Mat &frame, const cv::Rect &region) const
+{
+    ScopedStageTimer timer(*state.stats, DetectorStats::DetectAllSizes, state.frameStamp.sequence);
+
+    state.framesSinceFullScan = 0;
+
+    // Minimum face size is 1/5th of screen height
+    // Maximum face size is 2/3rds of screen height
+    int minFace = frame.rows / 5, maxFace = frame.rows * 2 / 3;
+    if (state.adaptiveResolution) {
+        minFace = (int)(frame.rows * state.resolutionController.minFaceFraction());
+        maxFace = (int)(frame.rows * state.resolutionController.maxFaceFraction());
+    }
+    detectFaces(state, frame, region, cv::Size(minFace, minFace), cv::Size(maxFace, maxFace));
+
+    if (state.allFaces.empty()) return;
+
+    // Single face mode tracks only the biggest face
+    if (state.maxTrackedFaces == 1) {
+        if (state.tracks.empty())
+            startTrack(state, frame, biggestFace(state.allFaces));
+        return;
+    }
+
+    // Assign detections to existing tracks, start new tracks for the rest
+    // beginning with the biggest faces
+    std::sort(state.allFaces.begin(), state.allFaces.end(),
+        [](const cv::Rect &a, const cv::Rect &b) { return a.area() > b.area(); });
+    matchTracks(state);
+
+    for (size_t i = 0; i < state.allFaces.size(); i++) {
+        const cv::Rect &face = state.allFaces[i];
+        if (state.faceTracks[i] >= 0) {
+            Track &track = state.tracks[state.faceTracks[i]];
+            track.confidence = 1;
+            track.state = FullFrameDetection;
+            track.templateMatchingRunning = false;
+            track.framesSinceCascade = 0;
+            updateTrack(frame, track, face);
+        }
+        else if ((int)state.tracks.size() < state.maxTrackedFaces && !overlapsTrack(state, face)) {
+            startTrack(state, frame, face);
+        }
+    }
+}
+
+/*
+* Pairs detections of state.allFaces with tracks greedily, the pair with
+* the highest intersection over union first, until no pair of unmatched ones
+* overlaps by MIN_MATCH_IOU. state.faceTracks holds the track index of every
+* detection, -1 for unmatched ones.
+*/
+void FaceDetectorCore::matchTracks(TrackerState &state) const
+{
+    state.faceTracks.assign(state.allFaces.size(), -1);
+    state.trackFaces.assign(state.tracks.size(), -1);
+
+    for (;;) {
+        double bestOverlap = MIN_MATCH_IOU;
+        int bestFace = -1, bestTrack = -1;
+        for (size_t i = 0; i < state.allFaces.size(); i++) {
+            if (state.faceTracks[i] >= 0) continue;
+            for (size_t j = 0; j < state.tracks.size(); j++) {
+                if (state.trackFaces[j] >= 0 || state.tracks[j].lost) continue;
+                double overlap = intersectionOverUnion(state.allFaces[i], state.tracks[j].face);
+                if (overlap >= bestOverlap) {
+                    bestOverlap = overlap;
+                    bestFace = (int)i;
+                    bestTrack = (int)j;
+                }
+            }
+        }
+        if (bestFace < 0)
+            return;
+
+        state.faceTracks[bestFace] = bestTrack;
+        state.trackFaces[bestTrack] = bestFace;
+    }
+}
+
+void FaceDetectorCore::detectFaceAroundRoi(TrackerState &state, const cv::Mat &frame, Track &track) const
+{
+    ScopedStageTimer timer(*state.stats, DetectorStats::DetectAroundRoi, state.frameStamp.sequence);
+
+    // Detect faces sized +/-20% off biggest face in previous search
+    detectFaces(state, frame, track.roi,
+        cv::Size(track.face.width * 8 / 10, track.face.height * 8 / 10),
+        cv::Size(track.face.width * 12 / 10, track.face.width * 12 / 10));
+
+    if (state.allFaces.empty())
+    {
+        // Activate template matching if not already started
+        if (!track.templateMatchingRunning)
+            track.templateMatchingStart = state.frameStamp.timestamp;
+        track.templateMatchingRunning = true;
+        return;
+    }
+
+    // Turn off template matching if running
+    track.confidence = 1;
+    track.state = RoiDetection;
+    track.templateMatchingRunning = false;
+    track.framesSinceCascade = 0;
+
+    // Get detected face
+    cv::Rect face = biggestFace(state.allFaces);
+
+    updateTrack(frame, track, face);
+}
+
+void FaceDetectorCore::detectFacesTemplateMatching(TrackerState &state, const cv::Mat &frame, Track &track) const
+{
+    // If template matching lasts for more than the max duration face is possibly
+    // lost so disable it and redetect using cascades. Duration is measured on
+    // frame timestamps, so recorded and dropped frames are timed as captured
+    if (state.frameStamp.timestamp - track.templateMatchingStart > state.templateMatchingMaxDuration * 1000) {
+        track.lost = true;
+		return;
+    }
+
+    followFace(state, frame, track);
+}
+
+/*
+* Moves the track to the face found by its tracker, starting from the last
+* face moved to the predicted center. Poor matches drop the track, fair ones
+* refresh the tracker and good ones keep it so small errors don't add up to
+* drift.
+*/
+void FaceDetectorCore::followFace(TrackerState &state, const cv::Mat &frame, Track &track) const
+{
+    ScopedStageTimer timer(*state.stats, DetectorStats::TemplateMatchingStage, state.frameStamp.sequence);
+
+    cv::Rect face = track.face;
+    if (state.motionPrediction) {
+        cv::Point2f center = track.motion.predictedCenter();
+        face.x = cvRound(center.x - face.width / 2.f);
+        face.y = cvRound(center.y - face.height / 2.f);
+    }
+
+    if (!track.tracker->update(state.pyramid, track.roi, face, track.confidence)) {
+        track.lost = true;
+        return;
+    }
+    track.state = TemplateMatching;
+
+    if (track.confidence < state.lostTrackingConfidence) {
+        track.lost = true;
+        return;
+    }
+
+    updateTrack(frame, track, face, track.confidence < state.highTrackingConfidence);
+}
+
+/*
+* Updates all tracks on the resized frame and returns the tracking state of
+* the frame.
+*/
+TrackingState FaceDetectorCore::trackFaces(TrackerState &state, const cv::Mat &frame) const
+{
+    // Forced full frame detection forgets tracked faces every frame
+    if (state.forceTrackingState && state.forcedTrackingState == FullFrameDetection) {
+        for (auto &track : state.tracks)
+            track.lost = true;
+        removeLostTracks(state);
+    }
+
+    if (state.tracks.empty()) {
+        // Detect using cascades over whole image, or where it changed since the last scan
+        cv::Rect region;
+        if (gateFullFrameScan(state, frame, region))
+            detectFaceAllSizes(state, frame, region);
+        return FullFrameDetection;
+    }
+
+    bool forcedRoi = state.forceTrackingState && state.forcedTrackingState == RoiDetection;
+    bool forcedTemplate = state.forceTrackingState && state.forcedTrackingState == TemplateMatching;
+
+    // Scheduler decides if tracked faces are redetected using cascades on this frame
+    bool cascadeFrame = forcedRoi || (!forcedTemplate && state.scheduler.beginFrame());
+    bool cascadeRan = false;
+    auto start = std::chrono::steady_clock::now();
+
+    TrackingState frameState = RoiDetection;
+    for (auto &track : state.tracks) {
+        if (state.motionPrediction) {
+            track.motion.predict();
+            track.roi = predictedRoi(track, cv::Rect(0, 0, frame.cols, frame.rows));
+        }
+
+        // Confident tracks skip cascade frames until the max cascade interval
+        track.framesSinceCascade++;
+        bool confident = track.confidence >= state.highTrackingConfidence
+            && track.framesSinceCascade < state.scheduler.maxInterval();
+
+        if (forcedTemplate) {
+            if (!track.templateMatchingRunning)
+                track.templateMatchingStart = state.frameStamp.timestamp;
+            track.templateMatchingRunning = true;
+        }
+        else if (forcedRoi || (cascadeFrame && !confident) || track.templateMatchingRunning
+            || track.confidence < state.minTrackingConfidence) {
+            cascadeRan = true;
+            detectFaceAroundRoi(state, frame, track); // Detect using cascades only in ROI
+        }
+        else {
+            // Between cascade frames follow the face with its tracker
+            frameState = TemplateMatching;
+            followFace(state, frame, track);
+            continue;
+        }
+
+        if (track.templateMatchingRunning) {
+            if (forcedRoi) {
+                track.lost = true;
+                continue;
+            }
+            frameState = TemplateMatching;
+            detectFacesTemplateMatching(state, frame, track); // Detect using template matching
+        }
+    }
+
+    // Tracks that moved out of the search area, e.g. onto an excluded screen, are dropped
+    if (!state.searchMask.empty()) {
+        for (auto &track : state.tracks) {
+            if (!state.searchMask.contains(centerOfRect(track.face)))
+                track.lost = true;
+        }
+    }
+    removeLostTracks(state);
+
+    if (!state.forceTrackingState)
+        state.scheduler.endFrame(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), cascadeRan);
+
+    // Periodically look for faces entering the frame while there are free track slots
+    if ((int)state.tracks.size() < state.maxTrackedFaces && ++state.framesSinceFullScan >= state.newFaceScanInterval)
+        detectFaceAllSizes(state, frame, cv::Rect(0, 0, frame.cols, frame.rows));
+
+    return frameState;
+}
+
+/*
+* Runs detection and tracking of one frame of the stream of state. The frame
+* is only read, and only during the call. The completed stamp of the frame is
+* kept in state.frameStamp.
+*/
+cv::Point FaceDetectorCore::process(TrackerState &state, const cv::Mat &frame, const PixelFormat format,
+    const FrameStamp &stamp) const
+{
+    // End of stream
+    if (frame.empty())
+        return state.tracks.empty() ? cv::Point() : state.tracks[0].position;
+
+    auto start = std::chrono::steady_clock::now();
+
+    // Frames without a sequence number follow the last one. Frames without a
+    // timestamp, or with one not after the last (cameras often report 0), are
+    // timed from the last frame at the frame rate
+    FrameStamp last = state.frameStamp;
+    state.frameStamp = stamp;
+    if (stamp.sequence == 0)
+        state.frameStamp.sequence = last.sequence + 1;
+    if (stamp.timestamp < 0 || (last.sequence > 0 && stamp.timestamp <= last.timestamp)) {
+        double frames = std::max((double)state.frameStamp.sequence - (double)last.sequence, 1.0);
+        state.frameStamp.timestamp = last.sequence > 0 ? last.timestamp + frames * 1000 / state.frameRate : 0;
+    }
+    if (stamp.captured == std::chrono::steady_clock::time_point())
+        state.frameStamp.captured = start;
+
+    // NV12 frames hold the Y plane in their first two thirds
+    cv::Mat input = format == PixelFormatNV12 ? frame.rowRange(0, frame.rows * 2 / 3) : frame;
+
+    // Downscale frame to state.resizedWidth width - keep aspect ratio
+    int width = state.adaptiveResolution ? state.resolutionController.width() : state.resizedWidth;
+    double previousScale = state.scale;
+    state.scale = (double) std::min(width, input.cols) / input.cols;
+    cv::Size resizedFrameSize = cv::Size((int)(state.scale*input.cols), (int)(state.scale*input.rows));
+    state.workingWidth = resizedFrameSize.width;
+    if (!state.searchMask.empty())
+        state.searchMask.update(input.size(), resizedFrameSize);
+
+    // Convert once per frame so the cascade and template matching run on one channel
+    cv::Mat grayFrame = state.grayFrameBuffer.view(resizedFrameSize, CV_8UC1);
+    {
+        ScopedStageTimer timer(*state.stats, DetectorStats::Resize, state.frameStamp.sequence);
+        if (input.channels() == 1) {
+            cv::resize(input, grayFrame, resizedFrameSize);
+        }
+        else {
+            // Downscale first so only the small frame gets converted
+            cv::Mat resizedFrame = state.resizedFrameBuffer.view(resizedFrameSize, input.type());
+            cv::resize(input, resizedFrame, resizedFrameSize);
+            cv::cvtColor(resizedFrame, grayFrame, input.channels() == 4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+        }
+    }
+    state.pyramid.setBase(grayFrame);
+
+    // Tracks are kept in resized frame pixels
+    if (state.scale != previousScale && !state.tracks.empty())
+        rescaleTracks(state, grayFrame, state.scale / previousScale);
+
+    TrackingState frameState = trackFaces(state, grayFrame);
+    state.countVectorGrowth();
+    state.stats->recordFrame(frameState);
+
+    if (state.adaptiveResolution) {
+        int smallestFace = 0, biggestFace = 0;
+        for (const auto &track : state.tracks) {
+            smallestFace = smallestFace == 0 ? track.face.height : std::min(smallestFace, track.face.height);
+            biggestFace = std::max(biggestFace, track.face.height);
+        }
+        double frameTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        state.resolutionController.update(frameTime, resizedFrameSize, smallestFace, biggestFace);
+    }
+
+    state.stats->recordSpan(DetectorStats::CaptureToResult, state.frameStamp.captured,
+        std::chrono::steady_clock::now(), state.frameStamp.sequence);
+
+    return state.tracks.empty() ? cv::Point() : state.tracks[0].position;
+}
+
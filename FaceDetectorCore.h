@@ -0,0 +1,81 @@
+#pragma once
+
+#include <opencv2\core.hpp>
+#include <opencv2\objdetect\objdetect.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "CascadeRegistry.h"
+#include "TrackerState.h"
+
+/*
+* Layout of the frames read from the capture. Color frames are downscaled and
+* then converted to gray, gray frames are only downscaled and NV12 frames
+* (a Y plane followed by interleaved UV rows) are used through their Y plane.
+*/
+enum PixelFormat
+{
+    PixelFormatBGR,
+    PixelFormatBGRA,
+    PixelFormatGray,
+    PixelFormatNV12
+};
+
+/*
+* Face detection and tracking over a shared cascade. The core itself never
+* changes after construction: every method is const and everything a stream
+* changes is kept in the TrackerState passed in. One core can therefore serve
+* any number of streams on any number of threads without locking, as long as
+* each TrackerState is used by one thread at a time.
+*/
+class FaceDetectorCore
+{
+public:
+    explicit FaceDetectorCore(const std::string cascadeFilePath);
+
+    bool                    empty() const;
+    const std::string&      cascadeFilePath() const;
+    cv::CascadeClassifier*  faceCascade() const;
+    bool                    splitsScans(const TrackerState &state) const;
+    cv::Point               process(TrackerState &state, const cv::Mat &frame, const PixelFormat format,
+                                const FrameStamp &stamp = FrameStamp()) const;
+
+    static void             setScanConcurrency(TrackerState &state, const int tasks, ThreadPool *pool = NULL);
+
+private:
+    typedef TrackerState::Track     Track;
+    typedef TrackerState::ScanJob   ScanJob;
+
+    std::shared_ptr<SharedCascade> m_faceCascade;
+
+    cv::Rect    doubleRectSize(const cv::Rect &inputRect, const cv::Rect &frameSize) const;
+    cv::Rect    predictedRoi(const Track &track, const cv::Rect &frameSize) const;
+    cv::Rect    biggestFace(std::vector<cv::Rect> &faces) const;
+    cv::Point   centerOfRect(const cv::Rect &rect) const;
+    bool        facesOverlap(const cv::Rect &a, const cv::Rect &b) const;
+    double      intersectionOverUnion(const cv::Rect &a, const cv::Rect &b) const;
+    bool        overlapsTrack(const TrackerState &state, const cv::Rect &rect) const;
+    void        matchTracks(TrackerState &state) const;
+    void        startTrack(TrackerState &state, const cv::Mat &frame, const cv::Rect &face) const;
+    void        updateTrack(const cv::Mat &frame, Track &track, const cv::Rect &face, const bool refreshTracker = true) const;
+    void        removeLostTracks(TrackerState &state) const;
+    void        rescaleTracks(TrackerState &state, const cv::Mat &frame, const double factor) const;
+    void        detectFaces(TrackerState &state, const cv::Mat &frame, const cv::Rect &region, const cv::Size minSize, const cv::Size maxSize) const;
+    void        detectFacesParallel(TrackerState &state, const cv::Mat &frame, const HaarCascade &cascade,
+                    const cv::Size minSize, const cv::Size maxSize) const;
+    void        runScanJobs(TrackerState &state, const int slot) const;
+    int         scanStep(const double scale) const;
+    void        scanImage(const cv::Mat &image, const cv::Mat &mask, const int step, HaarEvaluator &evaluator,
+                    std::vector<cv::Rect> &faces) const;
+    cv::Rect    scanCrop(const cv::Mat &image, const cv::Mat &mask, const cv::Size windowSize) const;
+    void        groupFaces(TrackerState &state) const;
+    void        removeMaskedFaces(TrackerState &state) const;
+    bool        gateFullFrameScan(TrackerState &state, const cv::Mat &frame, cv::Rect &region) const;
+    void        detectFaceAllSizes(TrackerState &state, const cv::Mat &frame, const cv::Rect &region) const;
+    void        detectFaceAroundRoi(TrackerState &state, const cv::Mat &frame, Track &track) const;
+    void        detectFacesTemplateMatching(TrackerState &state, const cv::Mat &frame, Track &track) const;
+    void        followFace(TrackerState &state, const cv::Mat &frame, Track &track) const;
+    TrackingState trackFaces(TrackerState &state, const cv::Mat &frame) const;
+};
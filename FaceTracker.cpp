@@ -0,0 +1,14 @@
+#include "FaceTracker.h"
+#include "CorrelationFilterTracker.h"
+#include "TemplateMatchingTracker.h"
+
+std::unique_ptr<FaceTracker> FaceTracker::create(const TrackerBackend backend, uint64 *allocationCounter)
+{
+    switch (backend) {
+    case TrackerBackendCorrelationFilter:
+        return std::unique_ptr<FaceTracker>(new CorrelationFilterTracker(allocationCounter));
+    case TrackerBackendTemplate:
+    default:
+        return std::unique_ptr<FaceTracker>(new TemplateMatchingTracker(allocationCounter));
+    }
+}
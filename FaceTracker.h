@@ -0,0 +1,39 @@
+#pragma once
+
+#include <opencv2\core.hpp>
+
+#include <memory>
+
+#include "ImagePyramid.h"
+
+/*
+* Tracker following faces between cascade detections. Template matches the
+* face template inside the ROI, CorrelationFilter follows the face with a
+* MOSSE correlation filter.
+*/
+enum TrackerBackend
+{
+    TrackerBackendTemplate,
+    TrackerBackendCorrelationFilter
+};
+
+/*
+* Follows one face on the frames the cascade doesn't run on. The detector
+* calls init() when a track starts, refresh() when the cascade confirmed the
+* face or the match of update() drifted, and update() on every frame tracked
+* without the cascade. Frames are the resized gray frames of the detector;
+* update() gets the detector's pyramid over the frame, so searches can use
+* its downscaled levels.
+*/
+class FaceTracker
+{
+public:
+    virtual ~FaceTracker() {}
+
+    virtual void        init(const cv::Mat &frame, const cv::Rect &face) = 0;
+    virtual void        refresh(const cv::Mat &frame, const cv::Rect &face) = 0;
+    virtual bool        update(ImagePyramid &pyramid, const cv::Rect &roi, cv::Rect &face, double &confidence) = 0;
+    virtual const char* name() const = 0;
+
+    static std::unique_ptr<FaceTracker> create(const TrackerBackend backend, uint64 *allocationCounter = NULL);
+};
@@ -0,0 +1,164 @@
+#include "FrameQueue.h"
+
+FrameQueue::FrameQueue(const size_t capacity, const OverflowPolicy policy)
+    : m_slots(std::max(capacity, (size_t)1)), m_stamps(m_slots.size()), m_policy(policy)
+{
+}
+
+/*
+* Allocates every slot for frames of the given size and type, so the ring
+* doesn't allocate while frames of that format are captured.
+*/
+void FrameQueue::preallocate(const cv::Size size, const int type)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto &slot : m_slots)
+        slot.create(size, type);
+}
+
+/*
+* Reserves the slot behind the newest frame for the producer. The slot is not
+* visible to the consumer until endWrite() so it can be filled without holding
+* the lock. Returns NULL once the queue is closed.
+*/
+cv::Mat *FrameQueue::beginWrite()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (m_policy == Block) {
+        m_notFull.wait(lock, [this] { return m_closed || m_count < m_slots.size(); });
+    }
+    else if (m_count == m_slots.size()) {
+        m_head = (m_head + 1) % m_slots.size();
+        m_count--;
+        m_droppedFrames++;
+    }
+
+    if (m_closed)
+        return NULL;
+
+    return &m_slots[(m_head + m_count) % m_slots.size()];
+}
+
+void FrameQueue::endWrite(const FrameStamp &stamp)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stamps[(m_head + m_count) % m_slots.size()] = stamp;
+        m_count++;
+        m_queuedFrames++;
+    }
+    m_notEmpty.notify_one();
+}
+
+/*
+* Hands the next frame to the caller by swapping it with the caller's buffer,
+* which takes the frame's place in the ring, so no pixels are copied. A
+* buffer still referenced by another Mat is released instead of being put
+* into the ring, so the producer never overwrites pixels the caller kept.
+* Under DropOldest the newest frame is taken and older ones are dropped.
+* Returns false once the queue is closed and drained. If stamp is given it
+* receives the stamp of the frame.
+*/
+bool FrameQueue::read(cv::Mat &frame, FrameStamp *stamp)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_notEmpty.wait(lock, [this] { return m_closed || m_count > 0; });
+
+    if (m_count == 0)
+        return false;
+
+    take(frame, stamp);
+    lock.unlock();
+    m_notFull.notify_one();
+    return true;
+}
+
+/*
+* Same as read() without waiting. Returns false right away if no frame is
+* queued; drained() tells if one can still come.
+*/
+bool FrameQueue::tryRead(cv::Mat &frame, FrameStamp *stamp)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_count == 0)
+        return false;
+
+    take(frame, stamp);
+    lock.unlock();
+    m_notFull.notify_one();
+    return true;
+}
+
+void FrameQueue::take(cv::Mat &frame, FrameStamp *stamp)
+{
+    size_t index = m_policy == DropOldest ? (m_head + m_count - 1) % m_slots.size() : m_head;
+    if (frame.u != NULL && frame.u->refcount > 1)
+        frame.release();
+    cv::swap(m_slots[index], frame);
+    if (stamp != NULL)
+        *stamp = m_stamps[index];
+
+    if (m_policy == DropOldest) {
+        m_droppedFrames += m_count - 1;
+        m_head = (m_head + m_count) % m_slots.size();
+        m_count = 0;
+    }
+    else {
+        m_head = (m_head + 1) % m_slots.size();
+        m_count--;
+    }
+}
+
+void FrameQueue::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+    }
+    m_notEmpty.notify_all();
+    m_notFull.notify_all();
+}
+
+bool FrameQueue::isClosed() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_closed;
+}
+
+/*
+* True once the queue is closed and every frame was read.
+*/
+bool FrameQueue::drained() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_closed && m_count == 0;
+}
+
+size_t FrameQueue::capacity() const
+{
+    return m_slots.size();
+}
+
+FrameQueue::OverflowPolicy FrameQueue::policy() const
+{
+    return m_policy;
+}
+
+size_t FrameQueue::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_count;
+}
+
+uint64 FrameQueue::queuedFrames() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_queuedFrames;
+}
+
+uint64 FrameQueue::droppedFrames() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_droppedFrames;
+}
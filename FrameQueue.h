@@ -0,0 +1,55 @@
+#pragma once
+
+#include <opencv2\core.hpp>
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include "FrameStamp.h"
+
+/*
+* Bounded ring of preallocated frames shared by one producer (capture thread)
+* and one consumer (detector thread). Every frame keeps the stamp it was
+* queued with.
+*/
+class FrameQueue
+{
+public:
+    enum OverflowPolicy
+    {
+        DropOldest, // Producer overwrites the oldest frame, consumer takes the newest one
+        Block       // Producer waits for a free slot, consumer takes frames in order
+    };
+
+    FrameQueue(const size_t capacity, const OverflowPolicy policy);
+
+    void            preallocate(const cv::Size size, const int type);
+    cv::Mat*        beginWrite();
+    void            endWrite(const FrameStamp &stamp = FrameStamp());
+    bool            read(cv::Mat &frame, FrameStamp *stamp = NULL);
+    bool            tryRead(cv::Mat &frame, FrameStamp *stamp = NULL);
+    void            close();
+    bool            isClosed() const;
+    bool            drained() const;
+    size_t          capacity() const;
+    OverflowPolicy  policy() const;
+    size_t          size() const;
+    uint64          queuedFrames() const;
+    uint64          droppedFrames() const;
+
+private:
+    std::vector<cv::Mat>    m_slots;
+    std::vector<FrameStamp> m_stamps;
+    OverflowPolicy          m_policy;
+    size_t                  m_head = 0;
+    size_t                  m_count = 0;
+    bool                    m_closed = false;
+    uint64                  m_queuedFrames = 0;
+    uint64                  m_droppedFrames = 0;
+    mutable std::mutex      m_mutex;
+    std::condition_variable m_notEmpty;
+    std::condition_variable m_notFull;
+
+    void    take(cv::Mat &frame, FrameStamp *stamp);
+};
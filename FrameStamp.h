@@ -0,0 +1,25 @@
+#pragma once
+
+#include <opencv2\core.hpp>
+
+#include <chrono>
+
+/*
+* Identity of a frame. Sequence numbers start at 1 and follow capture order,
+* so frames dropped before detection leave gaps; 0 means the next number
+* after the last processed frame. timestamp is the capture timestamp in
+* milliseconds from CAP_PROP_POS_MSEC or the caller, negative if unknown.
+* captured is when the frame was read and starts the capture to result
+* latency; unset means when detection started.
+*/
+struct FrameStamp
+{
+    uint64                                  sequence = 0;
+    double                                  timestamp = -1;
+    std::chrono::steady_clock::time_point   captured;
+
+    FrameStamp() {}
+    FrameStamp(const uint64 sequence, const double timestamp,
+        const std::chrono::steady_clock::time_point captured = std::chrono::steady_clock::time_point())
+        : sequence(sequence), timestamp(timestamp), captured(captured) {}
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+* Haar cascade of stumps in flat tables, as written by cascade_codegen. Rects
+* are in window coordinates with integer weights, so feature values can be
+* computed from integer integral images exactly.
+*/
+struct HaarRect
+{
+    int8_t      x;
+    int8_t      y;
+    int8_t      width;
+    int8_t      height;
+    int8_t      weight;
+};
+
+struct HaarStump
+{
+    uint16_t    firstRect;
+    uint16_t    rectCount;
+    float       threshold;  // Compared with the feature value divided by the window's norm
+    float       left;       // Added to the stage sum when the value is below threshold
+    float       right;
+};
+
+struct HaarStage
+{
+    uint16_t    firstStump;
+    uint16_t    stumpCount;
+    float       threshold;  // Window is rejected when the stage sum is below it
+};
+
+struct HaarCascade
+{
+    int                 width;
+    int                 height;
+    int                 stageCount;
+    const HaarStage*    stages;
+    const HaarStump*    stumps;
+    const HaarRect*     rects;
+};
@@ -0,0 +1,199 @@
+#include "HaarCascadeTables.h"
+#include <cmath>
+
+namespace
+{
+    // CascadeClassifier lowers stage thresholds by this much when loading a model
+    const float     STAGE_THRESHOLD_EPS = 1e-5f;
+}
+
+HaarCascadeTables::HaarCascadeTables()
+{
+    m_cascade.width = 0;
+    m_cascade.height = 0;
+    m_cascade.stageCount = 0;
+    m_cascade.stages = NULL;
+    m_cascade.stumps = NULL;
+    m_cascade.rects = NULL;
+}
+
+/*
+* Reads the cascade of the top level node of a cascade file. Returns false
+* and leaves the tables empty if it isn't a cascade HaarEvaluator can run,
+* with the reason in error.
+*/
+bool HaarCascadeTables::read(const cv::FileNode &root, std::string &error)
+{
+    m_stages.clear();
+    m_stumps.clear();
+    m_rects.clear();
+    m_cascade.stageCount = 0;
+
+    bool ok = root["stageType"].empty() ? readOldFormat(root, error) : readNewFormat(root, error);
+    if (ok && (m_stages.empty() || m_stumps.size() > 0xffff || m_rects.size() > 0xffff)) {
+        error = m_stages.empty() ? "cascade has no stages" : "cascade is too big";
+        ok = false;
+    }
+    if (!ok) {
+        m_stages.clear();
+        m_stumps.clear();
+        m_rects.clear();
+        return false;
+    }
+
+    m_cascade.stageCount = (int)m_stages.size();
+    m_cascade.stages = m_stages.data();
+    m_cascade.stumps = m_stumps.data();
+    m_cascade.rects = m_rects.data();
+    return true;
+}
+
+bool HaarCascadeTables::empty() const
+{
+    return m_cascade.stageCount == 0;
+}
+
+const HaarCascade &HaarCascadeTables::cascade() const
+{
+    return m_cascade;
+}
+
+const std::vector<HaarStage> &HaarCascadeTables::stages() const
+{
+    return m_stages;
+}
+
+const std::vector<HaarStump> &HaarCascadeTables::stumps() const
+{
+    return m_stumps;
+}
+
+const std::vector<HaarRect> &HaarCascadeTables::rects() const
+{
+    return m_rects;
+}
+
+bool HaarCascadeTables::readOldFormat(const cv::FileNode &root, std::string &error)
+{
+    cv::FileNode stagesNode = root["stages"];
+    if (root["size"].empty() || stagesNode.empty()) {
+        error = "not a haar cascade";
+        return false;
+    }
+
+    m_cascade.width = (int)root["size"][0];
+    m_cascade.height = (int)root["size"][1];
+
+    for (cv::FileNodeIterator stage = stagesNode.begin(); stage != stagesNode.end(); ++stage) {
+        cv::FileNode trees = (*stage)["trees"];
+
+        HaarStage haarStage;
+        haarStage.firstStump = (uint16_t)m_stumps.size();
+        haarStage.stumpCount = (uint16_t)trees.size();
+        haarStage.threshold = (float)(double)(*stage)["stage_threshold"] - STAGE_THRESHOLD_EPS;
+        m_stages.push_back(haarStage);
+
+        for (cv::FileNodeIterator tree = trees.begin(); tree != trees.end(); ++tree) {
+            cv::FileNode node = (*tree)[0];
+            if ((*tree).size() != 1 || node["left_val"].empty() || node["right_val"].empty()) {
+                error = "only cascades of stumps are supported";
+                return false;
+            }
+
+            HaarStump stump;
+            stump.firstRect = (uint16_t)m_rects.size();
+            stump.rectCount = (uint16_t)node["feature"]["rects"].size();
+            stump.threshold = (float)(double)node["threshold"];
+            stump.left = (float)(double)node["left_val"];
+            stump.right = (float)(double)node["right_val"];
+            m_stumps.push_back(stump);
+
+            if (!addRects(node["feature"], error))
+                return false;
+        }
+    }
+    return true;
+}
+
+/*
+* Stumps of the current format are trees of one internal node, whose first
+* leaf is taken below the threshold and second above, like CascadeClassifier
+* does when it loads them.
+*/
+bool HaarCascadeTables::readNewFormat(const cv::FileNode &root, std::string &error)
+{
+    if ((std::string)root["stageType"] != "BOOST" || (std::string)root["featureType"] != "HAAR") {
+        error = "not a haar cascade";
+        return false;
+    }
+
+    m_cascade.width = (int)root["width"];
+    m_cascade.height = (int)root["height"];
+
+    cv::FileNode features = root["features"];
+    cv::FileNode stagesNode = root["stages"];
+    for (cv::FileNodeIterator stage = stagesNode.begin(); stage != stagesNode.end(); ++stage) {
+        cv::FileNode weakClassifiers = (*stage)["weakClassifiers"];
+
+        HaarStage haarStage;
+        haarStage.firstStump = (uint16_t)m_stumps.size();
+        haarStage.stumpCount = (uint16_t)weakClassifiers.size();
+        haarStage.threshold = (float)(double)(*stage)["stageThreshold"] - STAGE_THRESHOLD_EPS;
+        m_stages.push_back(haarStage);
+
+        for (cv::FileNodeIterator weak = weakClassifiers.begin(); weak != weakClassifiers.end(); ++weak) {
+            cv::FileNode nodes = (*weak)["internalNodes"];
+            cv::FileNode leaves = (*weak)["leafValues"];
+            if (nodes.size() != 4 || leaves.size() != 2) {
+                error = "only cascades of stumps are supported";
+                return false;
+            }
+
+            int featureIndex = (int)nodes[2];
+            if (featureIndex < 0 || featureIndex >= (int)features.size()) {
+                error = "feature index out of range";
+                return false;
+            }
+            cv::FileNode feature = features[featureIndex];
+
+            HaarStump stump;
+            stump.firstRect = (uint16_t)m_rects.size();
+            stump.rectCount = (uint16_t)feature["rects"].size();
+            stump.threshold = (float)(double)nodes[3];
+            stump.left = (float)(double)leaves[0];
+            stump.right = (float)(double)leaves[1];
+            m_stumps.push_back(stump);
+
+            if (!addRects(feature, error))
+                return false;
+        }
+    }
+    return true;
+}
+
+bool HaarCascadeTables::addRects(const cv::FileNode &feature, std::string &error)
+{
+    if (!feature["tilted"].empty() && (int)feature["tilted"] != 0) {
+        error = "tilted features are not supported";
+        return false;
+    }
+
+    cv::FileNode rectsNode = feature["rects"];
+    for (cv::FileNodeIterator rect = rectsNode.begin(); rect != rectsNode.end(); ++rect) {
+        cv::FileNode values = *rect;
+        double weight = (double)values[4];
+        if (weight != std::floor(weight) || std::abs(weight) > 127) {
+            error = "feature weights must be small integers";
+            return false;
+        }
+
+        HaarRect haarRect;
+        haarRect.x = (int8_t)(int)values[0];
+        haarRect.y = (int8_t)(int)values[1];
+        haarRect.width = (int8_t)(int)values[2];
+        haarRect.height = (int8_t)(int)values[3];
+        haarRect.weight = (int8_t)weight;
+        m_rects.push_back(haarRect);
+    }
+    return true;
+}
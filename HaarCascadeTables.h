@@ -0,0 +1,40 @@
+#pragma once
+
+#include <opencv2\core.hpp>
+
+#include <string>
+#include <vector>
+
+#include "HaarCascade.h"
+
+/*
+* HaarCascade tables read from a cascade file at run time. Old style
+* (opencv-haar-classifier) and current (opencv-cascade-classifier) Haar
+* cascades of stumps with upright features and integer weights can be read,
+* which covers the haarcascade_frontalface_* models. cascade() points into
+* the tables, so they can't be copied.
+*/
+class HaarCascadeTables
+{
+public:
+    HaarCascadeTables();
+    HaarCascadeTables(const HaarCascadeTables &) = delete;
+    HaarCascadeTables &operator=(const HaarCascadeTables &) = delete;
+
+    bool                    read(const cv::FileNode &root, std::string &error);
+    bool                    empty() const;
+    const HaarCascade&      cascade() const;
+    const std::vector<HaarStage>&   stages() const;
+    const std::vector<HaarStump>&   stumps() const;
+    const std::vector<HaarRect>&    rects() const;
+
+private:
+    HaarCascade             m_cascade;
+    std::vector<HaarStage>  m_stages;
+    std::vector<HaarStump>  m_stumps;
+    std::vector<HaarRect>   m_rects;
+
+    bool    readOldFormat(const cv::FileNode &root, std::string &error);
+    bool    readNewFormat(const cv::FileNode &root, std::string &error);
+    bool    addRects(const cv::FileNode &feature, std::string &error);
+};
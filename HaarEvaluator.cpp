@@ -0,0 +1,379 @@
+#include "HaarEvaluator.h"
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define HAAR_EVALUATOR_X86 1
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define HAAR_EVALUATOR_AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define HAAR_EVALUATOR_AVX2_TARGET
+#endif
+#endif
+
+#include "FrontalFaceCascade.inc"
+
+namespace
+{
+    // Sum of a rect from the integral image given its 4 corner offsets
+    inline int rectSum(const int *p, const int *offsets)
+    {
+        return p[offsets[0]] - p[offsets[1]] - p[offsets[2]] + p[offsets[3]];
+    }
+
+    // Same for the squared integral, whose entries wrap but window sums fit
+    inline unsigned rectSquareSum(const int *p, const int *offsets)
+    {
+        return (unsigned)p[offsets[0]] - (unsigned)p[offsets[1]] - (unsigned)p[offsets[2]] + (unsigned)p[offsets[3]];
+    }
+
+    // True if any of count windows step apart has its center set in the mask
+    inline bool anyCenterSet(const uchar *centers, const int count, const int step)
+    {
+        for (int i = 0; i < count; i++) {
+            if (centers[i * step])
+                return true;
+        }
+        return false;
+    }
+
+    bool hasAvx2()
+    {
+#ifdef HAAR_EVALUATOR_X86
+        static const bool avx2 = cv::checkHardwareSupport(CV_CPU_AVX2);
+        return avx2;
+#else
+        return false;
+#endif
+    }
+
+#ifdef HAAR_EVALUATOR_X86
+    // Unsigned 32 bit lanes to double, exactly
+    HAAR_EVALUATOR_AVX2_TARGET
+    inline __m256d unsignedToDouble(const __m128i v)
+    {
+        return _mm256_add_pd(_mm256_cvtepi32_pd(_mm_xor_si128(v, _mm_set1_epi32(INT_MIN))),
+            _mm256_set1_pd(2147483648.0));
+    }
+
+    // Inverse norms of 4 windows and a mask of those that aren't flat
+    HAAR_EVALUATOR_AVX2_TARGET
+    inline int windowNormsAvx2(const __m128i windowSum, const __m128i windowSquareSum, const double normArea,
+        __m128 &inverseNorm)
+    {
+        __m256d area = _mm256_set1_pd(normArea);
+        __m256d sum = _mm256_cvtepi32_pd(windowSum);
+        __m256d variance = _mm256_sub_pd(_mm256_mul_pd(area, unsignedToDouble(windowSquareSum)), _mm256_mul_pd(sum, sum));
+        inverseNorm = _mm256_cvtpd_ps(_mm256_div_pd(_mm256_set1_pd(1.), _mm256_sqrt_pd(variance)));
+        __m256d valid = _mm256_and_pd(_mm256_cmp_pd(variance, _mm256_setzero_pd(), _CMP_GT_OQ),
+            _mm256_cmp_pd(_mm256_mul_pd(area, _mm256_cvtps_pd(inverseNorm)), _mm256_set1_pd(1e-1), _CMP_LT_OQ));
+        return _mm256_movemask_pd(valid);
+    }
+
+    /*
+    * Norm and first stage of the 8 windows at sum + i * step. Returns a mask
+    * of windows that aren't flat in the low byte and of windows passing the
+    * first stage in the high byte, and stores the inverse norms. Same float
+    * and double operations in the same order as the scalar path, so both give
+    * identical results.
+    */
+    HAAR_EVALUATOR_AVX2_TARGET
+    int stageZeroAvx2(const HaarCascade &cascade, const int *rectOffsets, const int *normOffsets,
+        const double normArea, const int *sum, const int *squareSum, const int step, float *inverseNorms)
+    {
+        const __m256i lanes = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(step));
+
+        #define GATHER(p, offsets) _mm256_add_epi32(_mm256_sub_epi32(_mm256_sub_epi32( \
+            _mm256_i32gather_epi32((p) + (offsets)[0], lanes, 4), _mm256_i32gather_epi32((p) + (offsets)[1], lanes, 4)), \
+            _mm256_i32gather_epi32((p) + (offsets)[2], lanes, 4)), _mm256_i32gather_epi32((p) + (offsets)[3], lanes, 4))
+
+        __m256i windowSum = GATHER(sum, normOffsets);
+        __m256i windowSquareSum = GATHER(squareSum, normOffsets);
+        __m128 inverseLow, inverseHigh;
+        int valid = windowNormsAvx2(_mm256_castsi256_si128(windowSum), _mm256_castsi256_si128(windowSquareSum),
+            normArea, inverseLow);
+        valid |= windowNormsAvx2(_mm256_extracti128_si256(windowSum, 1), _mm256_extracti128_si256(windowSquareSum, 1),
+            normArea, inverseHigh) << 4;
+        __m256 inverseNorm = _mm256_insertf128_ps(_mm256_castps128_ps256(inverseLow), inverseHigh, 1);
+        _mm256_storeu_ps(inverseNorms, inverseNorm);
+
+        // Leaves are added up in double like CascadeClassifier does
+        const HaarStage &stage = cascade.stages[0];
+        __m256d stageSumLow = _mm256_setzero_pd();
+        __m256d stageSumHigh = _mm256_setzero_pd();
+        for (int i = 0; i < stage.stumpCount; i++) {
+            const HaarStump &stump = cascade.stumps[stage.firstStump + i];
+            __m256i value = _mm256_setzero_si256();
+            for (int r = stump.firstRect; r < stump.firstRect + stump.rectCount; r++) {
+                value = _mm256_add_epi32(value, _mm256_mullo_epi32(GATHER(sum, rectOffsets + 4 * r),
+                    _mm256_set1_epi32(cascade.rects[r].weight)));
+            }
+            __m256 below = _mm256_cmp_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(value), inverseNorm),
+                _mm256_set1_ps(stump.threshold), _CMP_LT_OQ);
+            __m256 leaf = _mm256_blendv_ps(_mm256_set1_ps(stump.right), _mm256_set1_ps(stump.left), below);
+            stageSumLow = _mm256_add_pd(stageSumLow, _mm256_cvtps_pd(_mm256_castps256_ps128(leaf)));
+            stageSumHigh = _mm256_add_pd(stageSumHigh, _mm256_cvtps_pd(_mm256_extractf128_ps(leaf, 1)));
+        }
+        __m256d threshold = _mm256_set1_pd(stage.threshold);
+        int passed = _mm256_movemask_pd(_mm256_cmp_pd(stageSumLow, threshold, _CMP_GE_OQ))
+            | (_mm256_movemask_pd(_mm256_cmp_pd(stageSumHigh, threshold, _CMP_GE_OQ)) << 4);
+
+        #undef GATHER
+
+        return valid | ((valid & passed) << 8);
+    }
+#endif
+}
+
+HaarEvaluator::HaarEvaluator(const HaarCascade &cascade, uint64 *allocationCounter)
+    : m_cascade(NULL), m_integralBuffer(allocationCounter), m_allocationCounter(allocationCounter)
+{
+    setCascade(cascade);
+}
+
+/*
+* haarcascade_frontalface_default.xml compiled at build time.
+*/
+const HaarCascade &HaarEvaluator::frontalFace()
+{
+    return FRONTAL_FACE_CASCADE;
+}
+
+const char *HaarEvaluator::kernelName()
+{
+    return hasAvx2() ? "avx2" : "scalar";
+}
+
+/*
+* Integral of pixels and of squared pixels into CV_32SC1 images one pixel
+* bigger than image, with the same step. The squared integral wraps around
+* for big images but differences over a window are still exact.
+*/
+void HaarEvaluator::integrate(const cv::Mat &image, cv::Mat &sum, cv::Mat &squareSum)
+{
+    CV_Assert(image.type() == CV_8UC1);
+    CV_Assert(sum.type() == CV_32SC1 && sum.rows == image.rows + 1 && sum.cols == image.cols + 1);
+    CV_Assert(squareSum.type() == CV_32SC1 && squareSum.size() == sum.size() && squareSum.step == sum.step);
+
+    memset(sum.ptr<int>(0), 0, sum.cols * sizeof(int));
+    memset(squareSum.ptr<int>(0), 0, squareSum.cols * sizeof(int));
+    for (int y = 0; y < image.rows; y++) {
+        const uchar *pixels = image.ptr<uchar>(y);
+        const int *sumAbove = sum.ptr<int>(y);
+        const unsigned *squareSumAbove = squareSum.ptr<unsigned>(y);
+        int *sumRow = sum.ptr<int>(y + 1);
+        unsigned *squareSumRow = squareSum.ptr<unsigned>(y + 1);
+
+        int rowSum = 0;
+        unsigned rowSquareSum = 0;
+        sumRow[0] = 0;
+        squareSumRow[0] = 0;
+        for (int x = 0; x < image.cols; x++) {
+            rowSum += pixels[x];
+            rowSquareSum += pixels[x] * pixels[x];
+            sumRow[x + 1] = sumAbove[x + 1] + rowSum;
+            squareSumRow[x + 1] = squareSumAbove[x + 1] + rowSquareSum;
+        }
+    }
+}
+
+/*
+* Switches to another cascade. The evaluator keeps its buffers, so switching
+* back and forth costs no allocation.
+*/
+void HaarEvaluator::setCascade(const HaarCascade &cascade)
+{
+    if (&cascade == m_cascade)
+        return;
+
+    m_cascade = &cascade;
+    m_stride = 0;
+
+    // CascadeClassifier normalizes by the window shrunk by one pixel on every side
+    m_normArea = (double)((cascade.width - 2) * (cascade.height - 2));
+}
+
+cv::Size HaarEvaluator::windowSize() const
+{
+    return cv::Size(m_cascade->width, m_cascade->height);
+}
+
+/*
+* Finds all windows of the image accepted by every stage, scanning every
+* step-th row and column like CascadeClassifier does on one pyramid level.
+* With a mask of the image size, windows whose center is 0 in it are skipped
+* without evaluating any stage.
+*/
+void HaarEvaluator::detect(const cv::Mat &image, std::vector<cv::Rect> &windows, const int step,
+    const cv::Mat &mask)
+{
+    windows.clear();
+    if (image.cols < m_cascade->width || image.rows < m_cascade->height)
+        return;
+
+    cv::Size integralSize(image.cols + 1, image.rows + 1);
+    cv::Mat integrals = m_integralBuffer.view(cv::Size(integralSize.width, 2 * integralSize.height), CV_32SC1);
+    cv::Mat sum = integrals.rowRange(0, integralSize.height);
+    cv::Mat squareSum = integrals.rowRange(integralSize.height, 2 * integralSize.height);
+    integrate(image, sum, squareSum);
+
+    detect(sum, squareSum, 0, image.rows, windows, step, mask);
+}
+
+/*
+* Same over integral images from integrate(), for the windows whose top row
+* is from firstRow up to endRow. Integrals of a whole image can so be shared
+* by several evaluators each scanning a band of it. firstRow must be on the
+* step grid.
+*/
+void HaarEvaluator::detect(const cv::Mat &sum, const cv::Mat &squareSum, const int firstRow, const int endRow,
+    std::vector<cv::Rect> &windows, const int step, const cv::Mat &mask)
+{
+    CV_Assert(sum.type() == CV_32SC1 && squareSum.type() == CV_32SC1 && sum.step == squareSum.step);
+    CV_Assert(mask.empty() || (mask.type() == CV_8UC1 && mask.rows == sum.rows - 1 && mask.cols == sum.cols - 1));
+
+    windows.clear();
+    int columns = sum.cols - m_cascade->width;
+    int rows = std::min(endRow, sum.rows - m_cascade->height);
+    if (columns <= 0 || firstRow >= rows)
+        return;
+
+    setStride((int)(sum.step / sizeof(int)));
+
+    for (int y = firstRow; y < rows; y += step) {
+        const uchar *centers = mask.empty() ? NULL : mask.ptr<uchar>(y + m_cascade->height / 2) + m_cascade->width / 2;
+        detectRow(sum.ptr<int>(y), squareSum.ptr<int>(y), centers, y, columns, step, windows);
+    }
+}
+
+void HaarEvaluator::setStride(const int stride)
+{
+    if (stride == m_stride)
+        return;
+    m_stride = stride;
+
+    const HaarStump &lastStump = m_cascade->stumps[m_cascade->stages[m_cascade->stageCount - 1].firstStump
+        + m_cascade->stages[m_cascade->stageCount - 1].stumpCount - 1];
+    int rectCount = lastStump.firstRect + lastStump.rectCount;
+
+    if (m_rectOffsets.capacity() < 4 * (size_t)rectCount && m_allocationCounter != NULL)
+        (*m_allocationCounter)++;
+    m_rectOffsets.resize(4 * rectCount);
+    for (int i = 0; i < rectCount; i++) {
+        const HaarRect &rect = m_cascade->rects[i];
+        m_rectOffsets[4 * i + 0] = rect.y * stride + rect.x;
+        m_rectOffsets[4 * i + 1] = rect.y * stride + rect.x + rect.width;
+        m_rectOffsets[4 * i + 2] = (rect.y + rect.height) * stride + rect.x;
+        m_rectOffsets[4 * i + 3] = (rect.y + rect.height) * stride + rect.x + rect.width;
+    }
+
+    m_normOffsets[0] = stride + 1;
+    m_normOffsets[1] = stride + m_cascade->width - 1;
+    m_normOffsets[2] = (m_cascade->height - 1) * stride + 1;
+    m_normOffsets[3] = (m_cascade->height - 1) * stride + m_cascade->width - 1;
+}
+
+/*
+* Feature values are multiplied by the inverse of the window's norm,
+* area * standard deviation, before thresholding. Flat windows, whose
+* deviation is 10 or less, are rejected.
+*/
+bool HaarEvaluator::windowNorm(const int *sum, const int *squareSum, float &inverseNorm) const
+{
+    int windowSum = rectSum(sum, m_normOffsets);
+    unsigned windowSquareSum = rectSquareSum(squareSum, m_normOffsets);
+    double variance = m_normArea * windowSquareSum - (double)windowSum * windowSum;
+    if (!(variance > 0))
+        return false;
+
+    inverseNorm = (float)(1. / std::sqrt(variance));
+    return m_normArea * inverseNorm < 1e-1;
+}
+
+/*
+* Runs the stages from firstStage on. Returns the index of the stage that
+* rejected the window or stageCount if it was accepted.
+*/
+int HaarEvaluator::evaluate(const int *sum, const float inverseNorm, const int firstStage) const
+{
+    for (int s = firstStage; s < m_cascade->stageCount; s++) {
+        const HaarStage &stage = m_cascade->stages[s];
+        double stageSum = 0;
+        for (int i = 0; i < stage.stumpCount; i++) {
+            const HaarStump &stump = m_cascade->stumps[stage.firstStump + i];
+            int value = 0;
+            for (int r = stump.firstRect; r < stump.firstRect + stump.rectCount; r++)
+                value += m_cascade->rects[r].weight * rectSum(sum, &m_rectOffsets[4 * r]);
+            stageSum += (float)value * inverseNorm < stump.threshold ? stump.left : stump.right;
+        }
+        if (stageSum < stage.threshold)
+            return s;
+    }
+    return m_cascade->stageCount;
+}
+
+/*
+* CascadeClassifier skips the window after one rejected by the first stage,
+* so the same windows are skipped here, also when stage 0 ran 8 at a time.
+* centers points at the mask values of the window centers, NULL without mask.
+*/
+void HaarEvaluator::detectRow(const int *sum, const int *squareSum, const uchar *centers, const int y,
+    const int columns, const int step, std::vector<cv::Rect> &windows) const
+{
+    if (centers != NULL && !anyCenterSet(centers, (columns + step - 1) / step, step))
+        return;
+
+    bool skip = false;
+    int x = 0;
+
+#ifdef HAAR_EVALUATOR_X86
+    if (hasAvx2()) {
+        float inverseNorms[8];
+        for (; x + 7 * step < columns; x += 8 * step) {
+            if (centers != NULL && !anyCenterSet(centers + x, 8, step)) {
+                skip = false;
+                continue;
+            }
+            int masks = stageZeroAvx2(*m_cascade, m_rectOffsets.data(), m_normOffsets, m_normArea,
+                sum + x, squareSum + x, step, inverseNorms);
+            for (int k = 0; k < 8; k++) {
+                if (skip) {
+                    skip = false;
+                    continue;
+                }
+                int windowX = x + k * step;
+                if (centers != NULL && !centers[windowX])
+                    continue;
+                if (!(masks & (1 << k)))
+                    continue;
+                if (!(masks & (1 << (k + 8)))) {
+                    skip = true;
+                    continue;
+                }
+                if (evaluate(sum + windowX, inverseNorms[k], 1) == m_cascade->stageCount)
+                    windows.push_back(cv::Rect(windowX, y, m_cascade->width, m_cascade->height));
+            }
+        }
+    }
+#endif
+
+    for (; x < columns; x += step) {
+        if (skip) {
+            skip = false;
+            continue;
+        }
+        if (centers != NULL && !centers[x])
+            continue;
+        float inverseNorm;
+        if (!windowNorm(sum + x, squareSum + x, inverseNorm))
+            continue;
+
+        int stage = evaluate(sum + x, inverseNorm, 0);
+        if (stage == 0)
+            skip = true;
+        else if (stage == m_cascade->stageCount)
+            windows.push_back(cv::Rect(x, y, m_cascade->width, m_cascade->height));
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <opencv2\core.hpp>
+
+#include <vector>
+
+#include "HaarCascade.h"
+#include "ImageBuffer.h"
+
+/*
+* Single scale Haar cascade evaluator over cascades in HaarCascade tables,
+* compiled in or read from a cascade file. Sums come from integer integral
+* images and the first stage is evaluated for 8 windows at once with AVX2
+* when the CPU has it; only windows passing it are evaluated one by one.
+* Window norms and stage sums take the same operations as
+* cv::CascadeClassifier, so a pyramid level scanned with its step gives the
+* same windows.
+*/
+class HaarEvaluator
+{
+public:
+    explicit HaarEvaluator(const HaarCascade &cascade, uint64 *allocationCounter = NULL);
+
+    static const HaarCascade&   frontalFace();
+    static const char*          kernelName();
+    static void                 integrate(const cv::Mat &image, cv::Mat &sum, cv::Mat &squareSum);
+
+    void        setCascade(const HaarCascade &cascade);
+    cv::Size    windowSize() const;
+    void        detect(const cv::Mat &image, std::vector<cv::Rect> &windows, const int step = 2,
+                    const cv::Mat &mask = cv::Mat());
+    void        detect(const cv::Mat &sum, const cv::Mat &squareSum, const int firstRow, const int endRow,
+                    std::vector<cv::Rect> &windows, const int step = 2, const cv::Mat &mask = cv::Mat());
+
+private:
+    const HaarCascade*  m_cascade;
+    ImageBuffer         m_integralBuffer;   // Sum rows above squared sum rows, so both have the same stride
+    std::vector<int>    m_rectOffsets;      // 4 corners per rect for the current stride
+    int                 m_normOffsets[4];
+    double              m_normArea;
+    int                 m_stride = 0;
+    uint64*             m_allocationCounter;
+
+    void    setStride(const int stride);
+    bool    windowNorm(const int *sum, const int *squareSum, float &inverseNorm) const;
+    int     evaluate(const int *sum, const float inverseNorm, const int firstStage) const;
+    void    detectRow(const int *sum, const int *squareSum, const uchar *centers, const int y,
+                const int columns, const int step, std::vector<cv::Rect> &windows) const;
+};
@@ -0,0 +1,35 @@
+#include "ImageBuffer.h"
+
+ImageBuffer::ImageBuffer(uint64 *allocationCounter)
+    : m_allocationCounter(allocationCounter)
+{
+}
+
+void ImageBuffer::reserve(const cv::Size size, const int type)
+{
+    if (!m_storage.empty() && m_storage.type() == type &&
+        m_storage.cols >= size.width && m_storage.rows >= size.height)
+        return;
+
+    // Grow to cover both the old and the requested size
+    cv::Size newSize = size;
+    if (!m_storage.empty() && m_storage.type() == type) {
+        newSize.width = std::max(newSize.width, m_storage.cols);
+        newSize.height = std::max(newSize.height, m_storage.rows);
+    }
+
+    m_storage.create(newSize, type);
+    if (m_allocationCounter != NULL)
+        (*m_allocationCounter)++;
+}
+
+cv::Mat ImageBuffer::view(const cv::Size size, const int type)
+{
+    reserve(size, type);
+    return m_storage(cv::Rect(0, 0, size.width, size.height));
+}
+
+cv::Size ImageBuffer::capacity() const
+{
+    return m_storage.size();
+}
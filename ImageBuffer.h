@@ -0,0 +1,22 @@
+#pragma once
+
+#include <opencv2\core.hpp>
+
+/*
+* Image storage that is reused between frames. view() returns a header of the
+* requested size over the storage, which is only reallocated when it's too
+* small. Reallocations are counted so steady state can be checked for them.
+*/
+class ImageBuffer
+{
+public:
+    explicit ImageBuffer(uint64 *allocationCounter = NULL);
+
+    void        reserve(const cv::Size size, const int type);
+    cv::Mat     view(const cv::Size size, const int type);
+    cv::Size    capacity() const;
+
+private:
+    cv::Mat     m_storage;
+    uint64*     m_allocationCounter;
+};
@@ -0,0 +1,102 @@
+#include "ImagePyramid.h"
+#include <cmath>
+#include <opencv2\imgproc.hpp>
+
+ImagePyramid::ImagePyramid(const double scaleFactor, uint64 *allocationCounter)
+    : m_scaleFactor(scaleFactor), m_allocationCounter(allocationCounter), m_regionBuffer(allocationCounter)
+{
+}
+
+/*
+* Starts a new frame. The base isn't copied, it must stay valid until the
+* next call.
+*/
+void ImagePyramid::setBase(const cv::Mat &base)
+{
+    m_base = base;
+    std::fill(m_built.begin(), m_built.end(), false);
+}
+
+const cv::Mat &ImagePyramid::base() const
+{
+    return m_base;
+}
+
+double ImagePyramid::scaleFactor() const
+{
+    return m_scaleFactor;
+}
+
+/*
+* detectMultiScale multiplies its scale by the scale factor for every level
+* instead of raising it to a power, so the same is done here.
+*/
+double ImagePyramid::levelScale(const int level) const
+{
+    double scale = 1;
+    for (int i = 0; i < level; i++)
+        scale *= m_scaleFactor;
+    return scale;
+}
+
+/*
+* Size of an image of the given size downscaled to a level. detectMultiScale
+* divides by the scale as a float.
+*/
+cv::Size ImagePyramid::levelSize(const int level, const cv::Size size) const
+{
+    float scale = (float)levelScale(level);
+    return cv::Size(cvRound(size.width / scale), cvRound(size.height / scale));
+}
+
+/*
+* Maps a rect of a level, or of a region resized to it, back to the base
+* frame, or to the region, rounding like detectMultiScale.
+*/
+cv::Rect ImagePyramid::toBase(const int level, const cv::Rect &rect) const
+{
+    double scale = (float)levelScale(level);
+    return cv::Rect(cvRound(rect.x * scale), cvRound(rect.y * scale),
+        cvRound(rect.width * scale), cvRound(rect.height * scale));
+}
+
+const cv::Mat &ImagePyramid::level(const int level)
+{
+    if (level == 0)
+        return m_base;
+
+    if ((int)m_levels.size() <= level) {
+        m_levelBuffers.resize(level + 1, ImageBuffer(m_allocationCounter));
+        m_levels.resize(level + 1);
+        m_built.resize(level + 1, false);
+    }
+
+    if (!m_built[level]) {
+        cv::Size size = levelSize(level, m_base.size());
+        m_levels[level] = m_levelBuffers[level].view(size, m_base.type());
+        cv::resize(m_base, m_levels[level], size, 0, 0, cv::INTER_LINEAR_EXACT);
+        m_built[level] = true;
+    }
+    return m_levels[level];
+}
+
+/*
+* Returns rect of the base frame downscaled to a level. baseRect is set to
+* the part of rect inside the base frame, which is what the returned image
+* covers; toBase() maps its pixels to baseRect. The returned image is only
+* valid until the next call.
+*/
+cv::Mat ImagePyramid::region(const int level, const cv::Rect &rect, cv::Rect &baseRect)
+{
+    baseRect = rect & cv::Rect(0, 0, m_base.cols, m_base.rows);
+    if (level == 0)
+        return m_base(baseRect);
+
+    cv::Size size = levelSize(level, baseRect.size());
+    if (size.width <= 0 || size.height <= 0)
+        return cv::Mat();
+
+    cv::Mat regionImage = m_regionBuffer.view(size, m_base.type());
+    cv::resize(m_base(baseRect), regionImage, size, 0, 0, cv::INTER_LINEAR_EXACT);
+    return regionImage;
+}
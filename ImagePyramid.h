@@ -0,0 +1,40 @@
+#pragma once
+
+#include <opencv2\core.hpp>
+
+#include <vector>
+
+#include "ImageBuffer.h"
+
+/*
+* Image pyramid over the resized frame. Level i is the frame downscaled by
+* scaleFactor^i, with the scales, sizes and interpolation of the pyramid
+* cv::CascadeClassifier::detectMultiScale builds. Levels are built on first
+* use and kept until the next frame, so parallel scan tasks share them.
+* Regions are resized from the base frame on their own, like detectMultiScale
+* resizes the image it's given, so ROI searches and template matching only
+* pay for the area and levels they need.
+*/
+class ImagePyramid
+{
+public:
+    ImagePyramid(const double scaleFactor, uint64 *allocationCounter = NULL);
+
+    void            setBase(const cv::Mat &base);
+    const cv::Mat&  base() const;
+    double          scaleFactor() const;
+    double          levelScale(const int level) const;
+    cv::Size        levelSize(const int level, const cv::Size size) const;
+    cv::Rect        toBase(const int level, const cv::Rect &rect) const;
+    const cv::Mat&  level(const int level);
+    cv::Mat         region(const int level, const cv::Rect &rect, cv::Rect &baseRect);
+
+private:
+    double                      m_scaleFactor;
+    uint64*                     m_allocationCounter;
+    cv::Mat                     m_base;
+    std::vector<ImageBuffer>    m_levelBuffers;
+    std::vector<cv::Mat>        m_levels;
+    std::vector<bool>           m_built;
+    ImageBuffer                 m_regionBuffer;
+};
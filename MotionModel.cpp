@@ -0,0 +1,93 @@
+#include "MotionModel.h"
+#include <cmath>
+
+MotionModel::MotionModel(uint64 *allocationCounter)
+    : m_allocationCounter(allocationCounter)
+{
+}
+
+void MotionModel::init(const cv::Point2f center)
+{
+    if (m_filter.transitionMatrix.empty())
+        allocate();
+
+    // State and covariances are written in place to keep their storage
+    m_filter.statePost.at<float>(0) = center.x;
+    m_filter.statePost.at<float>(1) = center.y;
+    m_filter.statePost.at<float>(2) = 0;
+    m_filter.statePost.at<float>(3) = 0;
+    m_filter.statePost.copyTo(m_filter.statePre);
+
+    // Unknown velocity at start
+    cv::setIdentity(m_filter.errorCovPost, cv::Scalar(16));
+    m_filter.errorCovPost.at<float>(2, 2) = 100;
+    m_filter.errorCovPost.at<float>(3, 3) = 100;
+    m_filter.errorCovPost.copyTo(m_filter.errorCovPre);
+}
+
+cv::Point2f MotionModel::predict()
+{
+    const cv::Mat &state = m_filter.predict();
+    return cv::Point2f(state.at<float>(0), state.at<float>(1));
+}
+
+void MotionModel::correct(const cv::Point2f center)
+{
+    m_measurement.at<float>(0) = center.x;
+    m_measurement.at<float>(1) = center.y;
+    m_filter.correct(m_measurement);
+}
+
+cv::Point2f MotionModel::predictedCenter() const
+{
+    return cv::Point2f(m_filter.statePre.at<float>(0), m_filter.statePre.at<float>(1));
+}
+
+cv::Point2f MotionModel::velocity() const
+{
+    return cv::Point2f(m_filter.statePost.at<float>(2), m_filter.statePost.at<float>(3));
+}
+
+/*
+* One standard deviation of the predicted position.
+*/
+cv::Size2f MotionModel::uncertainty() const
+{
+    return cv::Size2f(std::sqrt(m_filter.errorCovPre.at<float>(0, 0)),
+        std::sqrt(m_filter.errorCovPre.at<float>(1, 1)));
+}
+
+/*
+* Converts the state to a frame scaled by factor, used when the resized width
+* of the detector changes.
+*/
+void MotionModel::rescale(const float factor)
+{
+    m_filter.statePost.convertTo(m_filter.statePost, -1, factor);
+    m_filter.statePre.convertTo(m_filter.statePre, -1, factor);
+    m_filter.errorCovPost.convertTo(m_filter.errorCovPost, -1, factor * factor);
+    m_filter.errorCovPre.convertTo(m_filter.errorCovPre, -1, factor * factor);
+}
+
+void MotionModel::allocate()
+{
+    m_filter.init(4, 2, 0, CV_32F);
+    m_measurement.create(2, 1, CV_32F);
+    if (m_allocationCounter != NULL)
+        (*m_allocationCounter)++;
+
+    m_filter.transitionMatrix = (cv::Mat_<float>(4, 4) <<
+        1, 0, 1, 0,
+        0, 1, 0, 1,
+        0, 0, 1, 0,
+        0, 0, 0, 1);
+    cv::setIdentity(m_filter.measurementMatrix);
+
+    // Faces accelerate slowly compared to the detection noise of a few pixels
+    m_filter.processNoiseCov = (cv::Mat_<float>(4, 4) <<
+        1, 0, 0, 0,
+        0, 1, 0, 0,
+        0, 0, 2, 0,
+        0, 0, 0, 2);
+    cv::setIdentity(m_filter.measurementNoiseCov, cv::Scalar(4));
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <opencv2\core.hpp>
+#include <opencv2\video\tracking.hpp>
+
+/*
+* Constant velocity Kalman filter over the face center. State is
+* (x, y, vx, vy) in pixels and pixels per frame of the resized frame. The
+* filter matrices are allocated by the first init() and reused after that,
+* so a model taken over from a dropped track doesn't allocate.
+*/
+class MotionModel
+{
+public:
+    explicit MotionModel(uint64 *allocationCounter = NULL);
+
+    void        init(const cv::Point2f center);
+    cv::Point2f predict();
+    void        correct(const cv::Point2f center);
+    cv::Point2f predictedCenter() const;
+    cv::Point2f velocity() const;
+    cv::Size2f  uncertainty() const;
+    void        rescale(const float factor);
+
+private:
+    cv::KalmanFilter    m_filter;
+    cv::Mat             m_measurement;
+    uint64*             m_allocationCounter;
+
+    void        allocate();
+};
@@ -0,0 +1,228 @@
+#include "MultiStreamEngine.h"
+#include <iostream>
+
+MultiStreamEngine::MultiStreamEngine(const std::string cascadeFilePath, const int threadCount)
+    : m_core(std::make_shared<const FaceDetectorCore>(cascadeFilePath)), m_pool(threadCount)
+{
+}
+
+MultiStreamEngine::~MultiStreamEngine()
+{
+    stop();
+}
+
+/*
+* Opens a file, camera stream or RTSP url. Returns the stream id or -1 if the
+* source couldn't be opened. Streams can only be added before start().
+*/
+int MultiStreamEngine::addStream(const std::string source)
+{
+    if (m_running)
+        return -1;
+
+    std::unique_ptr<Stream> stream(new Stream());
+    if (!stream->capture.open(source)) {
+        std::cerr << "Error opening video stream " << source << std::endl;
+        return -1;
+    }
+
+    stream->id = (int)m_streams.size();
+    stream->detector.reset(new VideoFaceDetector(m_core, stream->capture));
+    m_streams.push_back(std::move(stream));
+    return m_streams.back()->id;
+}
+
+int MultiStreamEngine::streamCount() const
+{
+    return (int)m_streams.size();
+}
+
+VideoFaceDetector &MultiStreamEngine::detector(const int streamId)
+{
+    return *m_streams[streamId]->detector;
+}
+
+/*
+* Callback is invoked on worker threads, possibly for several streams at once.
+*/
+void MultiStreamEngine::setResultCallback(ResultCallback callback)
+{
+    m_resultCallback = callback;
+}
+
+/*
+* Ring size and overflow policy of the capture threads. Block (default)
+* detects every frame in order, DropOldest always detects the newest frame
+* of live cameras. Applies to the next start().
+*/
+void MultiStreamEngine::setCaptureQueue(const size_t queueSize, const FrameQueue::OverflowPolicy policy)
+{
+    m_captureQueueSize = queueSize;
+    m_captureOverflowPolicy = policy;
+}
+
+/*
+* Traces the stages of every stream on its own row of trace, named after the
+* stream id. Streams added later are not traced.
+*/
+void MultiStreamEngine::setTrace(TraceLog *trace)
+{
+    for (auto &stream : m_streams) {
+        stream->detector->setTrace(trace, stream->id);
+        if (trace != NULL)
+            trace->setTrackName(stream->id, "stream " + std::to_string(stream->id));
+    }
+}
+
+/*
+* Appends every frame detected on the stream to log, see
+* VideoFaceDetector::setResultLog(). Streams need one log each, so a log's
+* timestamps don't go back.
+*/
+void MultiStreamEngine::setResultLog(const int streamId, ResultLogWriter *log)
+{
+    m_streams[streamId]->detector->setResultLog(log);
+}
+
+void MultiStreamEngine::start()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_running) return;
+        m_running = true;
+        m_stopping = false;
+        m_finishedStreams = 0;
+    }
+
+    for (auto &stream : m_streams) {
+        Stream *s = stream.get();
+        s->inFlight = false;
+        s->finished = false;
+        s->captureThread.reset(new CaptureThread(s->capture, m_captureQueueSize, m_captureOverflowPolicy,
+            [this, s] { frameCaptured(*s); }));
+    }
+}
+
+/*
+* Stops capturing and waits for the frames in flight. Closing the capture
+* queues wakes every stream, which then finishes without an end of stream
+* result.
+*/
+void MultiStreamEngine::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    for (auto &stream : m_streams) {
+        if (stream->captureThread)
+            stream->captureThread->stop();
+    }
+    wait();
+}
+
+/*
+* Blocks until every stream has reached its end or the engine was stopped.
+*/
+void MultiStreamEngine::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_finished.wait(lock, [this] { return !m_running || m_finishedStreams == (int)m_streams.size(); });
+    m_running = false;
+}
+
+/*
+* Called on the capture thread of stream when a frame was queued or the
+* queue closed. Submits detection unless the stream has a task in flight,
+* which picks the frame up when it's done.
+*/
+void MultiStreamEngine::frameCaptured(Stream &stream)
+{
+    std::lock_guard<std::mutex> lock(stream.mutex);
+    if (stream.inFlight || stream.finished)
+        return;
+
+    stream.inFlight = true;
+    Stream *s = &stream;
+    m_pool.submit([this, s] { processFrame(*s); });
+}
+
+void MultiStreamEngine::processFrame(Stream &stream)
+{
+    bool stopping;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        stopping = m_stopping;
+    }
+    if (stopping) {
+        finishStream(stream, false);
+        return;
+    }
+
+    FrameStamp stamp;
+    if (!stream.captureThread->tryRead(stream.frame, &stamp)) {
+        if (stream.captureThread->queue().drained())
+            finishStream(stream, true);
+        else
+            scheduleNext(stream);
+        return;
+    }
+
+    stream.detector->detect(stream.frame, stamp);
+
+    if (m_resultCallback) {
+        StreamResult result;
+        result.streamId = stream.id;
+        result.frameIndex = stream.frameIndex;
+        result.sequence = stream.detector->frameStamp().sequence;
+        result.timestamp = stream.detector->frameStamp().timestamp;
+        result.endOfStream = false;
+        result.faces = stream.detector->faces();
+        m_resultCallback(result);
+    }
+    stream.frameIndex++;
+
+    scheduleNext(stream);
+}
+
+/*
+* Queues the next detection of stream if a frame is waiting or the queue
+* closed, otherwise leaves it to the capture thread. Both decide under the
+* stream's lock, so a frame queued meanwhile is never missed. The next frame
+* runs after the other queued streams.
+*/
+void MultiStreamEngine::scheduleNext(Stream &stream)
+{
+    std::lock_guard<std::mutex> lock(stream.mutex);
+    const FrameQueue &queue = stream.captureThread->queue();
+    if (queue.size() == 0 && !queue.isClosed()) {
+        stream.inFlight = false;
+        return;
+    }
+
+    Stream *s = &stream;
+    m_pool.submit([this, s] { processFrame(*s); });
+}
+
+void MultiStreamEngine::finishStream(Stream &stream, const bool endOfStream)
+{
+    if (endOfStream && m_resultCallback) {
+        StreamResult result;
+        result.streamId = stream.id;
+        result.frameIndex = stream.frameIndex;
+        result.sequence = 0;
+        result.timestamp = stream.detector->frameStamp().timestamp;
+        result.endOfStream = true;
+        m_resultCallback(result);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(stream.mutex);
+        stream.finished = true;
+        stream.inFlight = false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_finishedStreams++;
+    m_finished.notify_all();
+}
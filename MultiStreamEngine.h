@@ -0,0 +1,83 @@
+#pragma once
+
+#include <opencv2\core.hpp>
+#include <opencv2\highgui\highgui.hpp>
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "CaptureThread.h"
+#include "ThreadPool.h"
+#include "VideoFaceDetector.h"
+
+struct StreamResult
+{
+    int                         streamId;
+    uint64                      frameIndex;
+    uint64                      sequence;       // Capture sequence number, 0 at the end of the stream
+    double                      timestamp;      // Capture timestamp in milliseconds
+    bool                        endOfStream;
+    std::vector<TrackedFace>    faces;
+};
+
+/*
+* Runs detection on many video streams over a shared thread pool. Every stream
+* is read by its own CaptureThread, and only detection of captured frames is
+* submitted to the pool, so no worker waits on a camera or decoder. Every
+* stream has at most one frame in flight, so its tracking state is only ever
+* touched by one worker at a time. All streams run through one
+* FaceDetectorCore.
+*/
+class MultiStreamEngine
+{
+public:
+    typedef std::function<void(const StreamResult&)> ResultCallback;
+
+    MultiStreamEngine(const std::string cascadeFilePath, const int threadCount = 0);
+    ~MultiStreamEngine();
+
+    int                     addStream(const std::string source);
+    int                     streamCount() const;
+    VideoFaceDetector&      detector(const int streamId);
+    void                    setResultCallback(ResultCallback callback);
+    void                    setCaptureQueue(const size_t queueSize, const FrameQueue::OverflowPolicy policy);
+    void                    setTrace(TraceLog *trace);
+    void                    setResultLog(const int streamId, ResultLogWriter *log);
+    void                    start();
+    void                    stop();
+    void                    wait();
+
+private:
+    struct Stream
+    {
+        int                                 id;
+        cv::VideoCapture                    capture;
+        std::unique_ptr<CaptureThread>      captureThread;
+        std::unique_ptr<VideoFaceDetector>  detector;
+        cv::Mat                             frame;
+        uint64                              frameIndex = 0;
+        std::mutex                          mutex;
+        bool                                inFlight = false;   // Detection task queued or running, under mutex
+        bool                                finished = false;
+    };
+
+    std::shared_ptr<const FaceDetectorCore> m_core;
+    std::vector<std::unique_ptr<Stream>>    m_streams;
+    ResultCallback                          m_resultCallback;
+    size_t                                  m_captureQueueSize = 2;
+    FrameQueue::OverflowPolicy              m_captureOverflowPolicy = FrameQueue::Block;
+    bool                                    m_running = false;
+    bool                                    m_stopping = false;
+    int                                     m_finishedStreams = 0;
+    std::mutex                              m_mutex;
+    std::condition_variable                 m_finished;
+    ThreadPool                              m_pool;
+
+    void    frameCaptured(Stream &stream);
+    void    processFrame(Stream &stream);
+    void    scheduleNext(Stream &stream);
+    void    finishStream(Stream &stream, const bool endOfStream);
+};
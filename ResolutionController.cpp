@@ -0,0 +1,142 @@
+#include "ResolutionController.h"
+#include <algorithm>
+#include <cstdlib>
+
+const double ResolutionController::SMOOTHING = 0.1;
+const double ResolutionController::DEFAULT_MIN_FACE_FRACTION = 1. / 5;
+const double ResolutionController::DEFAULT_MAX_FACE_FRACTION = 2. / 3;
+
+ResolutionController::ResolutionController()
+{
+}
+
+void ResolutionController::setWidthRange(const int minWidth, const int maxWidth)
+{
+    m_minWidth = std::max(minWidth, WIDTH_STEP);
+    m_maxWidth = std::max(maxWidth, m_minWidth);
+    reset(m_baseWidth);
+}
+
+int ResolutionController::minWidth() const
+{
+    return m_minWidth;
+}
+
+int ResolutionController::maxWidth() const
+{
+    return m_maxWidth;
+}
+
+/*
+* Height in resized pixels tracked faces are kept at. The cascade window is
+* 24 pixels, so the default of 48 leaves room for the ROI search at -20%.
+*/
+void ResolutionController::setTargetFaceHeight(const int pixels)
+{
+    m_targetFaceHeight = std::max(pixels, MIN_FACE_PIXELS);
+}
+
+int ResolutionController::targetFaceHeight() const
+{
+    return m_targetFaceHeight;
+}
+
+/*
+* Budget of 0 leaves the width to the face size alone.
+*/
+void ResolutionController::setFrameTimeBudget(const double s)
+{
+    m_frameTimeBudget = std::max(s, 0.);
+}
+
+double ResolutionController::frameTimeBudget() const
+{
+    return m_frameTimeBudget;
+}
+
+/*
+* Starts over from width, which is also used while no face is tracked.
+*/
+void ResolutionController::reset(const int width)
+{
+    m_baseWidth = width;
+    m_width = std::max(m_minWidth, std::min(width, m_maxWidth));
+    m_latencyCap = m_maxWidth;
+    m_frameTime = 0;
+    m_framesSinceChange = 0;
+    m_minFaceFraction = DEFAULT_MIN_FACE_FRACTION;
+    m_maxFaceFraction = DEFAULT_MAX_FACE_FRACTION;
+}
+
+int ResolutionController::width() const
+{
+    return m_width;
+}
+
+/*
+* Smallest face searched by full frame scans as a fraction of frame height.
+*/
+double ResolutionController::minFaceFraction() const
+{
+    return m_minFaceFraction;
+}
+
+/*
+* Biggest face searched by full frame scans as a fraction of frame height.
+*/
+double ResolutionController::maxFaceFraction() const
+{
+    return m_maxFaceFraction;
+}
+
+/*
+* Feeds one processed frame: its detection time, the resized frame size and
+* the heights of the smallest and biggest tracked face in resized pixels, 0
+* without tracked faces. Returns true if width() changed, the new width is
+* used from the next frame on.
+*/
+bool ResolutionController::update(const double frameTime, const cv::Size frameSize, const int smallestFace, const int biggestFace)
+{
+    m_frameTime = m_frameTime == 0 ? frameTime : m_frameTime + SMOOTHING * (frameTime - m_frameTime);
+
+    // Full frame scans keep looking for faces of the tracked sizes, so a face
+    // that is lost for a moment is found again
+    if (frameSize.height > 0) {
+        double smallestFraction = std::min((double)MIN_FACE_PIXELS / frameSize.height, DEFAULT_MIN_FACE_FRACTION);
+        m_minFaceFraction = DEFAULT_MIN_FACE_FRACTION;
+        m_maxFaceFraction = DEFAULT_MAX_FACE_FRACTION;
+        if (smallestFace > 0)
+            m_minFaceFraction = std::max(smallestFraction, std::min(DEFAULT_MIN_FACE_FRACTION, 0.8 * smallestFace / frameSize.height));
+        if (biggestFace > 0)
+            m_maxFaceFraction = std::max(DEFAULT_MAX_FACE_FRACTION, std::min(1., 1.25 * biggestFace / frameSize.height));
+    }
+
+    if (++m_framesSinceChange < HOLD_FRAMES)
+        return false;
+
+    // Latency cap drops below the current width while over budget and grows
+    // one step past it while there is plenty of headroom
+    if (m_frameTimeBudget > 0) {
+        if (m_frameTime > m_frameTimeBudget)
+            m_latencyCap = std::max(m_minWidth, frameSize.width * 4 / 5);
+        else if (m_frameTime < m_frameTimeBudget / 2)
+            m_latencyCap = std::min(m_maxWidth, std::max(m_latencyCap, frameSize.width * 5 / 4));
+    }
+
+    // Scale the smallest tracked face to the target height
+    int target = m_baseWidth;
+    if (smallestFace > 0)
+        target = (int)((double)frameSize.width * m_targetFaceHeight / smallestFace);
+    if (m_frameTimeBudget > 0)
+        target = std::min(target, m_latencyCap);
+    target = std::max(m_minWidth, std::min(target / WIDTH_STEP * WIDTH_STEP, m_maxWidth));
+
+    // Changes under 10% aren't worth rebuilding buffers and trackers
+    if (std::abs(target - m_width) * 10 < m_width)
+        return false;
+
+    m_width = target;
+    m_framesSinceChange = 0;
+    m_frameTime = 0;
+    return true;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <opencv2\core.hpp>
+
+/*
+* Picks the resized width and the face sizes searched by full frame scans.
+* Tracked faces are kept near a target height in resized pixels, so the
+* width drops when faces are big and close and grows when they are small.
+* Independently the measured frame time caps the width to stay within the
+* frame time budget. Widths change in steps with hysteresis and a hold time
+* so buffers and trackers aren't rebuilt every frame.
+*/
+class ResolutionController
+{
+public:
+    ResolutionController();
+
+    void    setWidthRange(const int minWidth, const int maxWidth);
+    int     minWidth() const;
+    int     maxWidth() const;
+    void    setTargetFaceHeight(const int pixels);
+    int     targetFaceHeight() const;
+    void    setFrameTimeBudget(const double s);
+    double  frameTimeBudget() const;
+    void    reset(const int width);
+    int     width() const;
+    double  minFaceFraction() const;
+    double  maxFaceFraction() const;
+    bool    update(const double frameTime, const cv::Size frameSize, const int smallestFace, const int biggestFace);
+
+private:
+    static const double SMOOTHING;
+    static const double DEFAULT_MIN_FACE_FRACTION;
+    static const double DEFAULT_MAX_FACE_FRACTION;
+    static const int    MIN_FACE_PIXELS = 24;
+    static const int    HOLD_FRAMES = 15;
+    static const int    WIDTH_STEP = 8;
+
+    int     m_minWidth = 160;
+    int     m_maxWidth = 640;
+    int     m_targetFaceHeight = 48;
+    double  m_frameTimeBudget = 0;
+    int     m_baseWidth = 320;
+    int     m_width = 320;
+    int     m_latencyCap = 640;
+    double  m_frameTime = 0;
+    int     m_framesSinceChange = 0;
+    double  m_minFaceFraction = DEFAULT_MIN_FACE_FRACTION;
+    double  m_maxFaceFraction = DEFAULT_MAX_FACE_FRACTION;
+};
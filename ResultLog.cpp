@@ -0,0 +1,330 @@
+#include "ResultLog.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const char      LOG_MAGIC[8] = { 'F', 'A', 'C', 'E', 'L', 'O', 'G', '1' };
+
+    // Magic followed by the record size, padded to one record
+    struct LogHeader
+    {
+        char        magic[8];
+        uint32_t    recordSize;
+        uint8_t     reserved[36];
+    };
+
+    static_assert(sizeof(LogHeader) == sizeof(ResultRecord), "Header takes one record slot");
+
+    // Records are buffered until this many are pending or the writer is flushed
+    const size_t    FLUSH_RECORDS = 4096;
+}
+
+ResultLogWriter::ResultLogWriter()
+{
+}
+
+ResultLogWriter::~ResultLogWriter()
+{
+    close();
+}
+
+/*
+* Opens a log for appending, creating it if it doesn't exist. An existing file
+* must be a log with the same record layout.
+*/
+bool ResultLogWriter::open(const std::string filePath)
+{
+    close();
+
+    m_file = fopen(filePath.c_str(), "ab+");
+    if (m_file == NULL) {
+        std::cerr << "Error opening result log " << filePath << std::endl;
+        return false;
+    }
+
+    fseek(m_file, 0, SEEK_END);
+    long fileSize = ftell(m_file);
+    if (fileSize == 0) {
+        LogHeader header = {};
+        memcpy(header.magic, LOG_MAGIC, sizeof(LOG_MAGIC));
+        header.recordSize = sizeof(ResultRecord);
+        fwrite(&header, sizeof(header), 1, m_file);
+        fflush(m_file);
+    }
+    else {
+        LogHeader header;
+        fseek(m_file, 0, SEEK_SET);
+        if (fread(&header, sizeof(header), 1, m_file) != 1 || memcmp(header.magic, LOG_MAGIC, sizeof(LOG_MAGIC)) != 0
+            || header.recordSize != sizeof(ResultRecord) || fileSize % sizeof(ResultRecord) != 0) {
+            std::cerr << "File " << filePath << " is not a result log or is damaged" << std::endl;
+            fclose(m_file);
+            m_file = NULL;
+            return false;
+        }
+    }
+
+    m_recordCount = m_writtenCount = 0;
+    m_stopping = m_flushRequested = false;
+    m_pending.reserve(FLUSH_RECORDS);
+    m_writing.reserve(FLUSH_RECORDS);
+    m_flushThread = std::thread(&ResultLogWriter::run, this);
+    return true;
+}
+
+/*
+* Writes the buffered records and closes the file.
+*/
+void ResultLogWriter::close()
+{
+    if (m_file == NULL)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_recordsAvailable.notify_one();
+    m_flushThread.join();
+
+    fclose(m_file);
+    m_file = NULL;
+}
+
+bool ResultLogWriter::isOpened() const
+{
+    return m_file != NULL;
+}
+
+/*
+* Appends one record per face, or a NO_FACES marker if there are none.
+* Timestamps should not decrease between calls so readers can search the log
+* by time.
+*/
+void ResultLogWriter::append(const int64 frameIndex, const double timestamp, const std::vector<TrackedFace> &faces)
+{
+    if (m_file == NULL)
+        return;
+
+    bool notify;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (faces.empty()) {
+            ResultRecord record = {};
+            record.frameIndex = frameIndex;
+            record.timestamp = timestamp;
+            record.trackId = ResultRecord::NO_FACES;
+            m_pending.push_back(record);
+        }
+        for (const auto &face : faces) {
+            ResultRecord record = {};
+            record.frameIndex = frameIndex;
+            record.timestamp = timestamp;
+            record.trackId = face.id;
+            record.x = face.face.x;
+            record.y = face.face.y;
+            record.width = face.face.width;
+            record.height = face.face.height;
+            record.confidence = (float)face.confidence;
+            record.state = (uint8_t)face.state;
+            m_pending.push_back(record);
+        }
+        m_recordCount += std::max(faces.size(), (size_t)1);
+        notify = m_pending.size() >= FLUSH_RECORDS;
+    }
+    if (notify)
+        m_recordsAvailable.notify_one();
+}
+
+/*
+* Blocks until every appended record is written to the file.
+*/
+void ResultLogWriter::flush()
+{
+    if (m_file == NULL)
+        return;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    uint64 target = m_recordCount;
+    m_flushRequested = true;
+    m_recordsAvailable.notify_one();
+    m_recordsWritten.wait(lock, [this, target] { return m_writtenCount >= target; });
+}
+
+uint64 ResultLogWriter::recordCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_recordCount;
+}
+
+/*
+* Swaps the pending buffer with an empty one and writes it outside the lock,
+* waking up when a buffer fills, on flush() or at least once a second.
+*/
+void ResultLogWriter::run()
+{
+    for (;;) {
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_recordsAvailable.wait_for(lock, std::chrono::seconds(1), [this] {
+                return m_stopping || m_flushRequested || m_pending.size() >= FLUSH_RECORDS;
+            });
+            stopping = m_stopping;
+            m_flushRequested = false;
+            m_pending.swap(m_writing);
+        }
+
+        if (!m_writing.empty()) {
+            fwrite(m_writing.data(), sizeof(ResultRecord), m_writing.size(), m_file);
+            fflush(m_file);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_writtenCount += m_writing.size();
+        }
+        m_writing.clear();
+        m_recordsWritten.notify_all();
+
+        if (stopping)
+            return;
+    }
+}
+
+ResultLogReader::ResultLogReader()
+{
+}
+
+ResultLogReader::~ResultLogReader()
+{
+    close();
+}
+
+bool ResultLogReader::open(const std::string filePath)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::cerr << "Error opening result log " << filePath << std::endl;
+        return false;
+    }
+    m_file = file;
+
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(file, &fileSize);
+    m_mappedSize = (size_t)fileSize.QuadPart;
+    if (m_mappedSize >= sizeof(LogHeader)) {
+        m_mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (m_mapping != NULL)
+            m_data = (const uchar*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+    }
+#else
+    m_file = ::open(filePath.c_str(), O_RDONLY);
+    if (m_file < 0) {
+        std::cerr << "Error opening result log " << filePath << std::endl;
+        return false;
+    }
+
+    struct stat fileStat;
+    fstat(m_file, &fileStat);
+    m_mappedSize = (size_t)fileStat.st_size;
+    if (m_mappedSize >= sizeof(LogHeader)) {
+        void *data = mmap(NULL, m_mappedSize, PROT_READ, MAP_SHARED, m_file, 0);
+        m_data = data == MAP_FAILED ? NULL : (const uchar*)data;
+    }
+#endif
+
+    const LogHeader *header = (const LogHeader*)m_data;
+    if (m_data == NULL || memcmp(header->magic, LOG_MAGIC, sizeof(LOG_MAGIC)) != 0
+        || header->recordSize != sizeof(ResultRecord)) {
+        std::cerr << "File " << filePath << " is not a result log" << std::endl;
+        close();
+        return false;
+    }
+
+    // A record cut short by a writer still appending is ignored
+    m_size = m_mappedSize / sizeof(ResultRecord) - 1;
+    return true;
+}
+
+void ResultLogReader::close()
+{
+#ifdef _WIN32
+    if (m_data != NULL) UnmapViewOfFile(m_data);
+    if (m_mapping != NULL) CloseHandle(m_mapping);
+    if (m_file != NULL) CloseHandle(m_file);
+    m_mapping = NULL;
+    m_file = NULL;
+#else
+    if (m_data != NULL) munmap((void*)m_data, m_mappedSize);
+    if (m_file >= 0) ::close(m_file);
+    m_file = -1;
+#endif
+    m_data = NULL;
+    m_mappedSize = m_size = 0;
+}
+
+bool ResultLogReader::isOpened() const
+{
+    return m_data != NULL;
+}
+
+size_t ResultLogReader::size() const
+{
+    return m_size;
+}
+
+const ResultRecord &ResultLogReader::operator[](const size_t index) const
+{
+    return begin()[index];
+}
+
+const ResultRecord *ResultLogReader::begin() const
+{
+    return m_data == NULL ? NULL : (const ResultRecord*)m_data + 1;
+}
+
+const ResultRecord *ResultLogReader::end() const
+{
+    return begin() + m_size;
+}
+
+/*
+* First record with a timestamp not before the given one.
+*/
+const ResultRecord *ResultLogReader::lowerBound(const double timestamp) const
+{
+    return std::lower_bound(begin(), end(), timestamp,
+        [](const ResultRecord &record, const double t) { return record.timestamp < t; });
+}
+
+/*
+* Records with from <= timestamp < to as the range [first, last).
+*/
+void ResultLogReader::range(const double from, const double to,
+    const ResultRecord *&first, const ResultRecord *&last) const
+{
+    first = lowerBound(from);
+    last = std::max(first, lowerBound(to));
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <opencv2\core.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "TrackerState.h"
+
+/*
+* One tracked face in one frame. Records are fixed size and little endian so
+* a log can be mapped and indexed directly. A frame without faces gets one
+* marker record with trackId NO_FACES and an empty rect, so readers can tell
+* it from a frame that wasn't processed.
+*/
+struct ResultRecord
+{
+    static const int32_t NO_FACES = 0;     // Track ids start at 1
+
+    int64       frameIndex;
+    double      timestamp;      // Milliseconds, non-decreasing within a log
+    int32_t     trackId;
+    int32_t     x;
+    int32_t     y;
+    int32_t     width;
+    int32_t     height;
+    float       confidence;
+    uint8_t     state;          // TrackingState
+    uint8_t     reserved[7];
+};
+
+static_assert(sizeof(ResultRecord) == 48, "ResultRecord layout must not change");
+
+/*
+* Append-only binary log of detection results, one file per stream. append()
+* only copies records into a buffer; a background thread writes them out.
+* VideoFaceDetector::setResultLog() appends every processed frame.
+*/
+class ResultLogWriter
+{
+public:
+    ResultLogWriter();
+    ~ResultLogWriter();
+
+    bool    open(const std::string filePath);
+    void    close();
+    bool    isOpened() const;
+    void    append(const int64 frameIndex, const double timestamp, const std::vector<TrackedFace> &faces);
+    void    flush();
+    uint64  recordCount() const;
+
+private:
+    FILE*                       m_file = NULL;
+    std::vector<ResultRecord>   m_pending;
+    std::vector<ResultRecord>   m_writing;
+    uint64                      m_recordCount = 0;
+    uint64                      m_writtenCount = 0;
+    bool                        m_stopping = false;
+    bool                        m_flushRequested = false;
+    mutable std::mutex          m_mutex;
+    std::condition_variable     m_recordsAvailable;
+    std::condition_variable     m_recordsWritten;
+    std::thread                 m_flushThread;
+
+    void    run();
+};
+
+/*
+* Read-only memory mapped view of a result log. Records are in append order,
+* so they are sorted by timestamp and can be searched by time.
+*/
+class ResultLogReader
+{
+public:
+    ResultLogReader();
+    ~ResultLogReader();
+
+    bool                    open(const std::string filePath);
+    void                    close();
+    bool                    isOpened() const;
+    size_t                  size() const;
+    const ResultRecord&     operator[](const size_t index) const;
+    const ResultRecord*     begin() const;
+    const ResultRecord*     end() const;
+    const ResultRecord*     lowerBound(const double timestamp) const;
+    void                    range(const double from, const double to,
+                                const ResultRecord *&first, const ResultRecord *&last) const;
+
+private:
+    const uchar*    m_data = NULL;
+    size_t          m_mappedSize = 0;
+    size_t          m_size = 0;
+#ifdef _WIN32
+    void*           m_file = NULL;
+    void*           m_mapping = NULL;
+#else
+    int             m_file = -1;
+#endif
+};
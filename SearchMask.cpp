@@ -0,0 +1,217 @@
+#include "SearchMask.h"
+#include <algorithm>
+#include <climits>
+#include <opencv2\imgproc.hpp>
+
+namespace
+{
+    std::vector<cv::Point> rectPolygon(const cv::Rect &rect)
+    {
+        cv::Point last(rect.x + rect.width - 1, rect.y + rect.height - 1);
+        return { rect.tl(), cv::Point(last.x, rect.y), last, cv::Point(rect.x, last.y) };
+    }
+
+    std::vector<std::vector<cv::Point>> scaledPolygons(const std::vector<std::vector<cv::Point>> &polygons,
+        const double scaleX, const double scaleY)
+    {
+        std::vector<std::vector<cv::Point>> scaled(polygons.size());
+        for (size_t i = 0; i < polygons.size(); i++) {
+            for (const auto &point : polygons[i])
+                scaled[i].push_back(cv::Point(cvRound(point.x * scaleX), cvRound(point.y * scaleY)));
+        }
+        return scaled;
+    }
+}
+
+SearchMask::SearchMask(uint64 *allocationCounter)
+    : m_allocationCounter(allocationCounter), m_baseBuffer(allocationCounter), m_regionBuffer(allocationCounter)
+{
+}
+
+void SearchMask::include(const std::vector<cv::Point> &polygon)
+{
+    m_inclusions.push_back(polygon);
+    m_changed = true;
+}
+
+void SearchMask::include(const cv::Rect &rect)
+{
+    include(rectPolygon(rect));
+}
+
+void SearchMask::exclude(const std::vector<cv::Point> &polygon)
+{
+    m_exclusions.push_back(polygon);
+    m_changed = true;
+}
+
+void SearchMask::exclude(const cv::Rect &rect)
+{
+    exclude(rectPolygon(rect));
+}
+
+/*
+* mask is an 8-bit image where 0 marks pixels that are not searched. It is
+* copied and stretched over the frame whatever its size.
+*/
+void SearchMask::setMask(const cv::Mat &mask)
+{
+    CV_Assert(mask.empty() || mask.type() == CV_8UC1);
+    mask.copyTo(m_mask);
+    m_changed = true;
+}
+
+void SearchMask::clear()
+{
+    m_inclusions.clear();
+    m_exclusions.clear();
+    m_mask.release();
+    m_changed = true;
+}
+
+/*
+* True if the whole frame is searched.
+*/
+bool SearchMask::empty() const
+{
+    return m_inclusions.empty() && m_exclusions.empty() && m_mask.empty();
+}
+
+/*
+* Rasterizes the area for frames of frameSize resized to size, unless it
+* already is.
+*/
+void SearchMask::update(const cv::Size frameSize, const cv::Size size)
+{
+    if (!m_changed && frameSize == m_frameSize && size == m_base.size())
+        return;
+
+    m_frameSize = frameSize;
+    m_changed = false;
+    m_levels.clear();
+    rasterize(size);
+}
+
+const cv::Mat &SearchMask::base() const
+{
+    return m_base;
+}
+
+/*
+* Bounding rect of the searched area of the resized frame.
+*/
+cv::Rect SearchMask::bounds() const
+{
+    return m_bounds;
+}
+
+bool SearchMask::contains(const cv::Point &point) const
+{
+    if (point.x < 0 || point.y < 0 || point.x >= m_base.cols || point.y >= m_base.rows)
+        return false;
+    return m_base.at<uchar>(point.y, point.x) != 0;
+}
+
+/*
+* The area scaled to a pyramid level of size. Levels are kept until the area
+* is rasterized again.
+*/
+const cv::Mat &SearchMask::level(const int level, const cv::Size size)
+{
+    if ((int)m_levels.size() <= level) {
+        m_levelBuffers.resize(level + 1, ImageBuffer(m_allocationCounter));
+        m_levels.resize(level + 1);
+    }
+
+    if (m_levels[level].size() != size) {
+        m_levels[level] = m_levelBuffers[level].view(size, CV_8UC1);
+        cv::resize(m_base, m_levels[level], size, 0, 0, cv::INTER_NEAREST);
+    }
+    return m_levels[level];
+}
+
+/*
+* The area under rect of the resized frame scaled to size, for ROI searches.
+* Valid until the next call.
+*/
+cv::Mat SearchMask::region(const cv::Rect &rect, const cv::Size size)
+{
+    cv::Mat region = m_regionBuffer.view(size, CV_8UC1);
+    cv::resize(m_base(rect), region, size, 0, 0, cv::INTER_NEAREST);
+    return region;
+}
+
+/*
+* Bounding rect of the window origins within origins whose window center is
+* set in mask, or an empty rect if there are none. The rect starts on even
+* coordinates so cropping to it keeps the 2 pixel scan grid.
+*/
+cv::Rect SearchMask::windowOrigins(const cv::Mat &mask, const cv::Rect &origins, const cv::Size windowSize)
+{
+    int minX = INT_MAX, maxX = -1, minY = INT_MAX, maxY = -1;
+    for (int y = origins.y; y < origins.y + origins.height; y++) {
+        const uchar *centers = mask.ptr<uchar>(y + windowSize.height / 2) + windowSize.width / 2;
+
+        int first = origins.x, last = origins.x + origins.width - 1;
+        while (first <= last && !centers[first])
+            first++;
+        if (first > last)
+            continue;
+        while (!centers[last])
+            last--;
+
+        minX = std::min(minX, first);
+        maxX = std::max(maxX, last);
+        minY = std::min(minY, y);
+        maxY = y;
+    }
+
+    if (maxY < 0)
+        return cv::Rect();
+
+    minX = std::max(minX & ~1, origins.x);
+    minY = std::max(minY & ~1, origins.y);
+    return cv::Rect(minX, minY, maxX - minX + 1, maxY - minY + 1);
+}
+
+void SearchMask::rasterize(const cv::Size size)
+{
+    double scaleX = (double)size.width / m_frameSize.width;
+    double scaleY = (double)size.height / m_frameSize.height;
+
+    m_base = m_baseBuffer.view(size, CV_8UC1);
+    if (!m_mask.empty())
+        cv::resize(m_mask, m_base, size, 0, 0, cv::INTER_NEAREST);
+    else
+        m_base.setTo(m_inclusions.empty() ? 255 : 0);
+
+    if (!m_inclusions.empty()) {
+        if (m_mask.empty()) {
+            cv::fillPoly(m_base, scaledPolygons(m_inclusions, scaleX, scaleY), cv::Scalar(255));
+        }
+        else {
+            // Searched where both the mask image and an inclusion allow it
+            cv::Mat included = m_regionBuffer.view(size, CV_8UC1);
+            included.setTo(0);
+            cv::fillPoly(included, scaledPolygons(m_inclusions, scaleX, scaleY), cv::Scalar(255));
+            cv::bitwise_and(m_base, included, m_base);
+        }
+    }
+
+    if (!m_exclusions.empty())
+        cv::fillPoly(m_base, scaledPolygons(m_exclusions, scaleX, scaleY), cv::Scalar(0));
+
+    int minX = INT_MAX, maxX = -1, minY = INT_MAX, maxY = -1;
+    for (int y = 0; y < m_base.rows; y++) {
+        const uchar *row = m_base.ptr<uchar>(y);
+        for (int x = 0; x < m_base.cols; x++) {
+            if (row[x]) {
+                minX = std::min(minX, x);
+                maxX = std::max(maxX, x);
+                minY = std::min(minY, y);
+                maxY = y;
+            }
+        }
+    }
+    m_bounds = maxY < 0 ? cv::Rect() : cv::Rect(minX, minY, maxX - minX + 1, maxY - minY + 1);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <opencv2\core.hpp>
+
+#include <vector>
+
+#include "ImageBuffer.h"
+
+/*
+* Static restriction of where a stream is searched for faces. Inclusion and
+* exclusion polygons and rectangles are given in frame pixels and a mask
+* image of any size (0 = not searched) is stretched over the frame. Without
+* inclusions or mask image the whole frame is included, and exclusions always
+* win. A cascade window is only searched if its center lies in the searched
+* area. The area is rasterized for the resized frame and its pyramid levels,
+* and only again when the resized frame size or the shapes change.
+*/
+class SearchMask
+{
+public:
+    explicit SearchMask(uint64 *allocationCounter = NULL);
+
+    void            include(const std::vector<cv::Point> &polygon);
+    void            include(const cv::Rect &rect);
+    void            exclude(const std::vector<cv::Point> &polygon);
+    void            exclude(const cv::Rect &rect);
+    void            setMask(const cv::Mat &mask);
+    void            clear();
+    bool            empty() const;
+
+    void            update(const cv::Size frameSize, const cv::Size size);
+    const cv::Mat&  base() const;
+    cv::Rect        bounds() const;
+    bool            contains(const cv::Point &point) const;
+    const cv::Mat&  level(const int level, const cv::Size size);
+    cv::Mat         region(const cv::Rect &rect, const cv::Size size);
+
+    static cv::Rect windowOrigins(const cv::Mat &mask, const cv::Rect &origins, const cv::Size windowSize);
+
+private:
+    uint64*                             m_allocationCounter;
+    std::vector<std::vector<cv::Point>> m_inclusions;
+    std::vector<std::vector<cv::Point>> m_exclusions;
+    cv::Mat                             m_mask;
+    bool                                m_changed = true;
+    cv::Size                            m_frameSize;
+    ImageBuffer                         m_baseBuffer;
+    cv::Mat                             m_base;
+    cv::Rect                            m_bounds;
+    std::vector<ImageBuffer>            m_levelBuffers;
+    std::vector<cv::Mat>                m_levels;
+    ImageBuffer                         m_regionBuffer;
+
+    void    rasterize(const cv::Size size);
+};
@@ -0,0 +1,275 @@
+#include "SegmentProcessor.h"
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <map>
+
+namespace
+{
+    double intersectionOverUnion(const cv::Rect &a, const cv::Rect &b)
+    {
+        double intersection = (a & b).area();
+        double unionArea = a.area() + b.area() - intersection;
+        return unionArea > 0 ? intersection / unionArea : 0;
+    }
+}
+
+SegmentProcessor::SegmentProcessor(const std::string cascadeFilePath, const int threadCount)
+    : m_core(std::make_shared<const FaceDetectorCore>(cascadeFilePath)), m_pool(threadCount)
+{
+}
+
+/*
+* Segments should be a multiple of the GOP size of the file so every segment
+* starts on a keyframe and seeking doesn't decode frames twice.
+*/
+void SegmentProcessor::setSegmentLength(const int frames)
+{
+    m_segmentLength = std::max(frames, 1);
+}
+
+int SegmentProcessor::segmentLength() const
+{
+    return m_segmentLength;
+}
+
+/*
+* Frames tracked before the start of every segment to match its faces with
+* the previous segment. 0 gives every segment its own track ids.
+*/
+void SegmentProcessor::setOverlap(const int frames)
+{
+    m_overlap = std::max(frames, 0);
+}
+
+int SegmentProcessor::overlap() const
+{
+    return m_overlap;
+}
+
+/*
+* Called for the detector of every segment before its first frame, possibly
+* on several threads at once.
+*/
+void SegmentProcessor::setDetectorSetup(DetectorSetup setup)
+{
+    m_detectorSetup = setup;
+}
+
+/*
+* Called with the faces of every frame in frame order, on the thread that
+* calls process(), as soon as the frame's segment and all segments before it
+* are done.
+*/
+void SegmentProcessor::setResultCallback(ResultCallback callback)
+{
+    m_resultCallback = callback;
+}
+
+/*
+* Processes the whole file and blocks until it's done. Files without a frame
+* count or without frame accurate seeking are processed as one segment. If a
+* segment fails the results of the segments before it have already been
+* handed out.
+*/
+bool SegmentProcessor::process(const std::string videoFilePath)
+{
+    m_segments.clear();
+
+    cv::VideoCapture capture(videoFilePath);
+    if (!capture.isOpened()) {
+        std::cerr << "Error opening video file " << videoFilePath << std::endl;
+        return false;
+    }
+    int64 frameCount = (int64)capture.get(cv::CAP_PROP_FRAME_COUNT);
+    bool split = frameCount > m_segmentLength && seekable(capture, frameCount);
+    if (frameCount > m_segmentLength && !split)
+        std::cerr << "Can't seek in " << videoFilePath << ", processing it as one segment" << std::endl;
+    capture.release();
+
+    if (!split) {
+        Segment segment;
+        segment.endFrame = std::numeric_limits<int64>::max();
+        m_segments.push_back(segment);
+    }
+    for (int64 first = 0; split && first < frameCount; first += m_segmentLength) {
+        Segment segment;
+        segment.firstFrame = first;
+        segment.endFrame = first + m_segmentLength;
+        segment.readStart = std::max(first - m_overlap, (int64)0);
+        m_segments.push_back(segment);
+    }
+
+    // Frame counts are estimates for some containers, the last segment reads to the end
+    m_segments.back().endFrame = std::numeric_limits<int64>::max();
+
+    for (auto &segment : m_segments) {
+        Segment *s = &segment;
+        m_pool.submit([this, videoFilePath, s] {
+            processSegment(videoFilePath, *s);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            s->done = true;
+            m_finished.notify_all();
+        });
+    }
+
+    // Segments are stitched in order, each only needs the one before it.
+    // Every segment is waited for, the tasks point into m_segments
+    bool failed = false;
+    int nextId = 1;
+    Segment *previous = NULL;
+    for (auto &segment : m_segments) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_finished.wait(lock, [&segment] { return segment.done; });
+        }
+
+        failed |= segment.failed;
+        if (!failed) {
+            stitchSegment(segment, previous, nextId);
+            if (m_resultCallback) {
+                for (const auto &frame : segment.frames)
+                    m_resultCallback(frame);
+            }
+        }
+
+        std::vector<FrameFaces>().swap(segment.overlapFrames);
+        if (previous != NULL)
+            std::vector<FrameFaces>().swap(previous->frames);
+        previous = &segment;
+    }
+    if (previous != NULL)
+        std::vector<FrameFaces>().swap(previous->frames);
+
+    return !failed;
+}
+
+int SegmentProcessor::segmentCount() const
+{
+    return (int)m_segments.size();
+}
+
+/*
+* True if capture seeks to a frame and reports where it landed: on the frame
+* or on an earlier keyframe after the start. Segments are read from there, so
+* a backend that can't seek would decode the file from the start for every
+* segment.
+*/
+bool SegmentProcessor::seekable(cv::VideoCapture &capture, const int64 frameCount) const
+{
+    int64 target = std::min((int64)m_segmentLength, frameCount - 1);
+    if (!capture.set(cv::CAP_PROP_POS_FRAMES, (double)target))
+        return false;
+
+    int64 position = (int64)capture.get(cv::CAP_PROP_POS_FRAMES);
+    return position > 0 && position <= target;
+}
+
+void SegmentProcessor::processSegment(const std::string &videoFilePath, Segment &segment)
+{
+    cv::VideoCapture capture(videoFilePath);
+    if (!capture.isOpened()) {
+        std::cerr << "Error opening video file " << videoFilePath << std::endl;
+        segment.failed = true;
+        return;
+    }
+
+    // Frames are numbered from where the capture landed, which can be a
+    // keyframe before the segment; frames up to readStart are only decoded
+    int64 position = 0;
+    if (segment.readStart > 0) {
+        bool seeked = capture.set(cv::CAP_PROP_POS_FRAMES, (double)segment.readStart);
+        position = (int64)capture.get(cv::CAP_PROP_POS_FRAMES);
+        if (!seeked || position < 0 || position > segment.readStart) {
+            std::cerr << "Error seeking to frame " << segment.readStart << " of " << videoFilePath << std::endl;
+            segment.failed = true;
+            return;
+        }
+    }
+
+    VideoFaceDetector detector(m_core);
+    if (m_detectorSetup)
+        m_detectorSetup(detector);
+
+    cv::Mat frame;
+    for (int64 i = position; i < segment.endFrame; i++) {
+        if (i < segment.readStart) {
+            if (!capture.grab())
+                break;
+            continue;
+        }
+        if (!capture.read(frame))
+            break;
+
+        double timestamp = capture.get(cv::CAP_PROP_POS_MSEC);
+        detector.detect(frame, timestamp);
+
+        FrameFaces result;
+        result.frameIndex = i;
+        result.timestamp = timestamp;
+        result.faces = detector.faces();
+        if (i < segment.firstFrame)
+            segment.overlapFrames.push_back(result);
+        else
+            segment.frames.push_back(result);
+    }
+}
+
+/*
+* Gives every track of segment an id unique over the file. A track seen in
+* the overlap frames of the segment takes the id of the previous segment's
+* track it overlaps best on the same frames (mean IoU of at least 0.5).
+*/
+void SegmentProcessor::stitchSegment(Segment &segment, const Segment *previous, int &nextId)
+{
+    std::map<int, int> ids;
+
+    if (previous != NULL && !segment.overlapFrames.empty()) {
+        // Summed IoU and shared frame count of every local/previous id pair
+        std::map<std::pair<int, int>, std::pair<double, int>> overlaps;
+        for (const auto &frame : segment.overlapFrames) {
+            auto match = std::lower_bound(previous->frames.begin(), previous->frames.end(), frame.frameIndex,
+                [](const FrameFaces &f, const int64 index) { return f.frameIndex < index; });
+            if (match == previous->frames.end() || match->frameIndex != frame.frameIndex)
+                continue;
+
+            for (const auto &face : frame.faces) {
+                for (const auto &previousFace : match->faces) {
+                    auto &overlap = overlaps[std::make_pair(face.id, previousFace.id)];
+                    overlap.first += intersectionOverUnion(face.face, previousFace.face);
+                    overlap.second++;
+                }
+            }
+        }
+
+        std::vector<std::pair<double, std::pair<int, int>>> candidates;
+        for (const auto &overlap : overlaps) {
+            if (overlap.second.first / overlap.second.second >= 0.5)
+                candidates.push_back(std::make_pair(overlap.second.first, overlap.first));
+        }
+        std::sort(candidates.begin(), candidates.end(),
+            [](const std::pair<double, std::pair<int, int>> &a, const std::pair<double, std::pair<int, int>> &b) {
+                return a.first != b.first ? a.first > b.first : a.second < b.second;
+            });
+
+        std::vector<int> takenIds;
+        for (const auto &candidate : candidates) {
+            int localId = candidate.second.first;
+            int previousId = candidate.second.second;
+            if (ids.count(localId) || std::find(takenIds.begin(), takenIds.end(), previousId) != takenIds.end())
+                continue;
+            ids[localId] = previousId;
+            takenIds.push_back(previousId);
+        }
+    }
+
+    for (auto &frame : segment.frames) {
+        for (auto &face : frame.faces) {
+            auto id = ids.find(face.id);
+            if (id == ids.end())
+                id = ids.insert(std::make_pair(face.id, nextId++)).first;
+            face.id = id->second;
+        }
+    }
+}
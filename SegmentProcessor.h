@@ -0,0 +1,75 @@
+#pragma once
+
+#include <opencv2\core.hpp>
+#include <opencv2\highgui\highgui.hpp>
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ThreadPool.h"
+#include "VideoFaceDetector.h"
+
+struct FrameFaces
+{
+    int64                       frameIndex;
+    double                      timestamp;  // Milliseconds from the start of the file
+    std::vector<TrackedFace>    faces;
+};
+
+/*
+* Headless batch processing of a video file. The file is split into segments
+* of segmentLength frames which are tracked in parallel, every segment with
+* its own capture and detector, so a segment starts with a full frame scan.
+* The detectors share one FaceDetectorCore and thus one loaded cascade.
+* Each segment also tracks the overlap frames before its start; faces found
+* there are matched with the previous segment to keep track ids continuous.
+* Segments are stitched in order as they finish and their frames are handed
+* to the result callback, so results of the whole file are never held.
+*/
+class SegmentProcessor
+{
+public:
+    typedef std::function<void(VideoFaceDetector&)> DetectorSetup;
+    typedef std::function<void(const FrameFaces&)> ResultCallback;
+
+    SegmentProcessor(const std::string cascadeFilePath, const int threadCount = 0);
+
+    void                            setSegmentLength(const int frames);
+    int                             segmentLength() const;
+    void                            setOverlap(const int frames);
+    int                             overlap() const;
+    void                            setDetectorSetup(DetectorSetup setup);
+    void                            setResultCallback(ResultCallback callback);
+    bool                            process(const std::string videoFilePath);
+    int                             segmentCount() const;
+
+private:
+    struct Segment
+    {
+        int64                   firstFrame = 0;
+        int64                   endFrame = 0;
+        int64                   readStart = 0;
+        bool                    failed = false;
+        bool                    done = false;
+        std::vector<FrameFaces> overlapFrames;
+        std::vector<FrameFaces> frames;
+    };
+
+    std::shared_ptr<const FaceDetectorCore> m_core;
+    int                         m_segmentLength = 250;
+    int                         m_overlap = 10;
+    DetectorSetup               m_detectorSetup;
+    ResultCallback              m_resultCallback;
+    std::vector<Segment>        m_segments;
+    std::mutex                  m_mutex;
+    std::condition_variable     m_finished;
+    ThreadPool                  m_pool;
+
+    bool    seekable(cv::VideoCapture &capture, const int64 frameCount) const;
+    void    processSegment(const std::string &videoFilePath, Segment &segment);
+    void    stitchSegment(Segment &segment, const Segment *previous, int &nextId);
+};
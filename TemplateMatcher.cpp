@@ -0,0 +1,203 @@
+#include "TemplateMatcher.h"
+#include <cfloat>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define TEMPLATE_MATCHER_X86 1
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define TEMPLATE_MATCHER_AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define TEMPLATE_MATCHER_AVX2_TARGET
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define TEMPLATE_MATCHER_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+    /*
+    * Accumulates sum((I - T)^2) and sum(I^2) over one template window.
+    */
+    void windowScalar(const uchar *image, const size_t imageStep,
+        const uchar *templ, const size_t templStep, const int rowBytes, const int rows,
+        int64 &squaredDifference, int64 &imageEnergy)
+    {
+        int64 difference = 0, energy = 0;
+        for (int r = 0; r < rows; r++) {
+            const uchar *a = image + r * imageStep;
+            const uchar *b = templ + r * templStep;
+            int rowDifference = 0, rowEnergy = 0;
+            for (int i = 0; i < rowBytes; i++) {
+                int d = a[i] - b[i];
+                rowDifference += d * d;
+                rowEnergy += a[i] * a[i];
+            }
+            difference += rowDifference;
+            energy += rowEnergy;
+        }
+        squaredDifference = difference;
+        imageEnergy = energy;
+    }
+
+#ifdef TEMPLATE_MATCHER_X86
+    TEMPLATE_MATCHER_AVX2_TARGET
+    inline int64 horizontalSum(const __m256i v)
+    {
+        // Lanes are unsigned and their sum can exceed 32 bits, add them in 64 bits
+        __m256i sum = _mm256_add_epi64(_mm256_cvtepu32_epi64(_mm256_castsi256_si128(v)),
+            _mm256_cvtepu32_epi64(_mm256_extracti128_si256(v, 1)));
+        __m128i pairs = _mm_add_epi64(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        int64 lanes[2];
+        _mm_storeu_si128((__m128i*)lanes, pairs);
+        return lanes[0] + lanes[1];
+    }
+
+    /*
+    * 16 pixels per step widened to 16 bits; madd squares and adds pairs into
+    * 32 bit lanes, read as unsigned, which can't overflow for templates up to
+    * ~500k bytes.
+    */
+    TEMPLATE_MATCHER_AVX2_TARGET
+    void windowAvx2(const uchar *image, const size_t imageStep,
+        const uchar *templ, const size_t templStep, const int rowBytes, const int rows,
+        int64 &squaredDifference, int64 &imageEnergy)
+    {
+        __m256i differenceSum = _mm256_setzero_si256();
+        __m256i energySum = _mm256_setzero_si256();
+        int64 difference = 0, energy = 0;
+
+        for (int r = 0; r < rows; r++) {
+            const uchar *a = image + r * imageStep;
+            const uchar *b = templ + r * templStep;
+            int i = 0;
+            for (; i + 16 <= rowBytes; i += 16) {
+                __m256i va = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(a + i)));
+                __m256i vb = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(b + i)));
+                __m256i d = _mm256_sub_epi16(va, vb);
+                differenceSum = _mm256_add_epi32(differenceSum, _mm256_madd_epi16(d, d));
+                energySum = _mm256_add_epi32(energySum, _mm256_madd_epi16(va, va));
+            }
+            for (; i < rowBytes; i++) {
+                int d = a[i] - b[i];
+                difference += d * d;
+                energy += a[i] * a[i];
+            }
+        }
+
+        squaredDifference = difference + horizontalSum(differenceSum);
+        imageEnergy = energy + horizontalSum(energySum);
+    }
+#endif
+
+#ifdef TEMPLATE_MATCHER_NEON
+    void windowNeon(const uchar *image, const size_t imageStep,
+        const uchar *templ, const size_t templStep, const int rowBytes, const int rows,
+        int64 &squaredDifference, int64 &imageEnergy)
+    {
+        uint32x4_t differenceSum = vdupq_n_u32(0);
+        uint32x4_t energySum = vdupq_n_u32(0);
+        int64 difference = 0, energy = 0;
+
+        for (int r = 0; r < rows; r++) {
+            const uchar *a = image + r * imageStep;
+            const uchar *b = templ + r * templStep;
+            int i = 0;
+            for (; i + 8 <= rowBytes; i += 8) {
+                uint8x8_t va = vld1_u8(a + i);
+                uint8x8_t vb = vld1_u8(b + i);
+                uint8x8_t d = vabd_u8(va, vb);
+                uint16x8_t d2 = vmull_u8(d, d);
+                uint16x8_t a2 = vmull_u8(va, va);
+                differenceSum = vpadalq_u16(differenceSum, d2);
+                energySum = vpadalq_u16(energySum, a2);
+            }
+            for (; i < rowBytes; i++) {
+                int d = a[i] - b[i];
+                difference += d * d;
+                energy += a[i] * a[i];
+            }
+        }
+
+        uint64x2_t differencePairs = vpaddlq_u32(differenceSum);
+        uint64x2_t energyPairs = vpaddlq_u32(energySum);
+        squaredDifference = difference + (int64)(vgetq_lane_u64(differencePairs, 0) + vgetq_lane_u64(differencePairs, 1));
+        imageEnergy = energy + (int64)(vgetq_lane_u64(energyPairs, 0) + vgetq_lane_u64(energyPairs, 1));
+    }
+#endif
+}
+
+TemplateMatcher::WindowKernel TemplateMatcher::kernel()
+{
+    static const WindowKernel selected = []() -> WindowKernel {
+#ifdef TEMPLATE_MATCHER_X86
+        if (cv::checkHardwareSupport(CV_CPU_AVX2))
+            return windowAvx2;
+#endif
+#ifdef TEMPLATE_MATCHER_NEON
+        return windowNeon;
+#endif
+        return windowScalar;
+    }();
+    return selected;
+}
+
+const char *TemplateMatcher::kernelName()
+{
+    WindowKernel selected = kernel();
+#ifdef TEMPLATE_MATCHER_X86
+    if (selected == windowAvx2) return "avx2";
+#endif
+#ifdef TEMPLATE_MATCHER_NEON
+    if (selected == windowNeon) return "neon";
+#endif
+    return selected == windowScalar ? "scalar" : "unknown";
+}
+
+/*
+* Returns the lowest TM_SQDIFF_NORMED score and stores its top left corner in
+* location. Ties resolve to the first position in row order like minMaxLoc.
+* Scores are clamped to [0, 1] the way matchTemplate does. squaredDifference,
+* if given, receives the raw TM_SQDIFF score of that position.
+*/
+double TemplateMatcher::match(const cv::Mat &image, const cv::Mat &templ, cv::Point &location,
+    int64 *squaredDifference)
+{
+    CV_Assert(image.depth() == CV_8U && image.type() == templ.type());
+    CV_Assert(image.cols >= templ.cols && image.rows >= templ.rows);
+
+    WindowKernel window = kernel();
+    const int channels = image.channels();
+    const int rowBytes = templ.cols * channels;
+
+    int64 unused, templateEnergy;
+    window(templ.data, templ.step, templ.data, templ.step, rowBytes, templ.rows, unused, templateEnergy);
+    double templateNorm = std::sqrt((double)templateEnergy);
+
+    double best = DBL_MAX;
+    int64 bestDifference = 0;
+    location = cv::Point(0, 0);
+    for (int y = 0; y <= image.rows - templ.rows; y++) {
+        const uchar *row = image.ptr(y);
+        for (int x = 0; x <= image.cols - templ.cols; x++) {
+            int64 difference, imageEnergy;
+            window(row + x * channels, image.step, templ.data, templ.step, rowBytes, templ.rows,
+                difference, imageEnergy);
+
+            double norm = std::sqrt((double)imageEnergy) * templateNorm;
+            double score = difference < norm ? difference / norm : 1.;
+            if (score < best) {
+                best = score;
+                bestDifference = difference;
+                location = cv::Point(x, y);
+            }
+        }
+    }
+
+    if (squaredDifference != NULL)
+        *squaredDifference = bestDifference;
+    return best;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <opencv2\core.hpp>
+
+/*
+* Normalized squared difference template matching for 8-bit images. Scores
+* every template position and keeps the best one in a single pass, instead
+* of writing the whole result map with matchTemplate and searching it with
+* minMaxLoc. The kernel is picked at runtime: AVX2 or NEON when the CPU has
+* it, otherwise plain C++.
+*/
+class TemplateMatcher
+{
+public:
+    static double       match(const cv::Mat &image, const cv::Mat &templ, cv::Point &location,
+                            int64 *squaredDifference = NULL);
+    static const char*  kernelName();
+
+private:
+    typedef void (*WindowKernel)(const uchar *image, const size_t imageStep,
+        const uchar *templ, const size_t templStep, const int rowBytes, const int rows,
+        int64 &squaredDifference, int64 &imageEnergy);
+
+    static WindowKernel kernel();
+};
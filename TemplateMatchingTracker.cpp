@@ -0,0 +1,116 @@
+#include "TemplateMatchingTracker.h"
+#include "TemplateMatcher.h"
+#include <algorithm>
+#include <cmath>
+#include <opencv2\imgproc.hpp>
+
+// RMS difference in gray levels at which a template match has no confidence left
+const double TemplateMatchingTracker::MAX_RMS_DIFFERENCE = 80;
+
+TemplateMatchingTracker::TemplateMatchingTracker(uint64 *allocationCounter)
+    : m_templateBuffer(allocationCounter), m_coarseTemplateBuffer(allocationCounter)
+{
+}
+
+void TemplateMatchingTracker::init(const cv::Mat &frame, const cv::Rect &face)
+{
+    refresh(frame, face);
+}
+
+/*
+* Copies the middle half of the face. The buffer holds templates of any face
+* in the frame, so the template is never reallocated while tracking.
+*/
+void TemplateMatchingTracker::refresh(const cv::Mat &frame, const cv::Rect &face)
+{
+    cv::Rect templateRect(face.x + face.width / 4, face.y + face.height / 4, face.width / 2, face.height / 2);
+
+    m_templateBuffer.reserve(cv::Size(frame.cols / 2 + 1, frame.rows / 2 + 1), frame.type());
+    m_template = m_templateBuffer.view(templateRect.size(), frame.type());
+    frame(templateRect).copyTo(m_template);
+    m_coarseLevel = 0;
+}
+
+/*
+* Moves face to the best match of the template inside roi. The found face is
+* twice the template, clipped to the frame.
+*/
+bool TemplateMatchingTracker::update(ImagePyramid &pyramid, const cv::Rect &roi, cv::Rect &face, double &confidence)
+{
+    const cv::Mat &frame = pyramid.base();
+
+    // Edge case when face exits frame while tracked
+    if (m_template.rows <= 1 || m_template.cols <= 1)
+        return false;
+
+    // Edge case when roi got clipped smaller than the template
+    if (roi.width < m_template.cols || roi.height < m_template.rows)
+        return false;
+
+    // Narrow the search down on a pyramid level first, then match on the frame
+    cv::Rect searchRect = roi;
+    coarseMatch(pyramid, roi, searchRect);
+
+    // Template matching with last known face, best position found in the same pass
+    cv::Point minLoc;
+    int64 squaredDifference;
+    TemplateMatcher::match(frame(searchRect), m_template, minLoc, &squaredDifference);
+    double rmsDifference = std::sqrt((double)squaredDifference / m_template.total());
+    confidence = std::max(0., 1 - rmsDifference / MAX_RMS_DIFFERENCE);
+
+    // Double the matched template around its center, clipped to the frame
+    cv::Rect match(minLoc.x + searchRect.x, minLoc.y + searchRect.y, m_template.cols, m_template.rows);
+    face = cv::Rect(match.x - match.width / 2, match.y - match.height / 2, match.width * 2, match.height * 2)
+        & cv::Rect(0, 0, frame.cols, frame.rows);
+    return true;
+}
+
+/*
+* Matches the template downscaled to the deepest level where it keeps
+* MIN_COARSE_TEMPLATE pixels against roi on that level. searchRect is set to
+* the part of roi around the match that can hold the best frame match, one
+* level pixel plus rounding around it. Leaves searchRect alone and returns
+* false if the template is too small for any level but the frame.
+*/
+bool TemplateMatchingTracker::coarseMatch(ImagePyramid &pyramid, const cv::Rect &roi, cv::Rect &searchRect)
+{
+    int level = 0;
+    for (;;) {
+        cv::Size size = pyramid.levelSize(level + 1, m_template.size());
+        if (size.width < MIN_COARSE_TEMPLATE || size.height < MIN_COARSE_TEMPLATE)
+            break;
+        level++;
+    }
+    if (level == 0)
+        return false;
+
+    // The coarse template is scaled once per template
+    if (level != m_coarseLevel) {
+        cv::Size size = pyramid.levelSize(level, m_template.size());
+        m_coarseTemplateBuffer.reserve(m_templateBuffer.capacity(), m_template.type());
+        m_coarseTemplate = m_coarseTemplateBuffer.view(size, m_template.type());
+        cv::resize(m_template, m_coarseTemplate, size, 0, 0, cv::INTER_LINEAR_EXACT);
+        m_coarseLevel = level;
+    }
+
+    cv::Rect baseRect;
+    cv::Mat region = pyramid.region(level, roi, baseRect);
+    if (region.cols < m_coarseTemplate.cols || region.rows < m_coarseTemplate.rows)
+        return false;
+
+    cv::Point coarseLoc;
+    TemplateMatcher::match(region, m_coarseTemplate, coarseLoc);
+
+    cv::Rect coarse = pyramid.toBase(level, cv::Rect(coarseLoc, cv::Size(1, 1)));
+    int margin = (int)std::ceil(pyramid.levelScale(level)) + 1;
+    searchRect = cv::Rect(baseRect.x + coarse.x - margin, baseRect.y + coarse.y - margin,
+        m_template.cols + 2 * margin, m_template.rows + 2 * margin) & baseRect;
+    if (searchRect.width < m_template.cols || searchRect.height < m_template.rows)
+        searchRect = roi;
+    return true;
+}
+
+const char *TemplateMatchingTracker::name() const
+{
+    return "template";
+}
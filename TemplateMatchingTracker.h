@@ -0,0 +1,35 @@
+#pragma once
+
+#include "FaceTracker.h"
+#include "ImageBuffer.h"
+
+/*
+* Tracks the middle half of the face by template matching inside the ROI.
+* Big templates are first matched on the deepest pyramid level where they
+* keep MIN_COARSE_TEMPLATE pixels and then only around that match on the
+* frame. Confidence falls linearly with the RMS difference of the raw
+* squared difference score, which unlike the normalized score doesn't depend
+* on the brightness of the face.
+*/
+class TemplateMatchingTracker : public FaceTracker
+{
+public:
+    explicit TemplateMatchingTracker(uint64 *allocationCounter = NULL);
+
+    void        init(const cv::Mat &frame, const cv::Rect &face) override;
+    void        refresh(const cv::Mat &frame, const cv::Rect &face) override;
+    bool        update(ImagePyramid &pyramid, const cv::Rect &roi, cv::Rect &face, double &confidence) override;
+    const char* name() const override;
+
+private:
+    static const double MAX_RMS_DIFFERENCE;
+    static const int    MIN_COARSE_TEMPLATE = 16;
+
+    ImageBuffer m_templateBuffer;
+    cv::Mat     m_template;
+    ImageBuffer m_coarseTemplateBuffer;
+    cv::Mat     m_coarseTemplate;
+    int         m_coarseLevel = 0;      // Level m_coarseTemplate is scaled to, 0 if not built
+
+    bool        coarseMatch(ImagePyramid &pyramid, const cv::Rect &roi, cv::Rect &searchRect);
+};
@@ -0,0 +1,130 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace
+{
+    thread_local const ThreadPool* t_pool = nullptr;
+    thread_local int t_workerIndex = -1;
+}
+
+/*
+* threadCount of 0 sizes the pool to the number of cores.
+*/
+ThreadPool::ThreadPool(const int threadCount)
+    : m_pendingTasks(0), m_nextQueue(0)
+{
+    int count = threadCount > 0 ? threadCount : (int)std::thread::hardware_concurrency();
+    count = std::max(count, 1);
+
+    for (int i = 0; i < count; i++)
+        m_queues.emplace_back(new WorkerQueue());
+    for (int i = 0; i < count; i++)
+        m_threads.emplace_back(&ThreadPool::run, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stopping = true;
+    }
+    m_wakeUp.notify_all();
+
+    for (auto &thread : m_threads)
+        thread.join();
+}
+
+void ThreadPool::submit(Task task)
+{
+    // Keep tasks submitted by a worker on that worker, spread the rest
+    int index = currentWorker();
+    if (index < 0)
+        index = (int)(m_nextQueue++ % m_queues.size());
+
+    {
+        std::lock_guard<std::mutex> lock(m_queues[index]->mutex);
+        m_queues[index]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_pendingTasks++;
+    }
+    m_wakeUp.notify_one();
+}
+
+/*
+* Runs one queued task on the calling thread. Threads waiting for results of
+* their own tasks use this to help instead of blocking a worker.
+*/
+bool ThreadPool::runPendingTask()
+{
+    int index = currentWorker();
+    Task task;
+    if (!popTask(index < 0 ? 0 : index, task))
+        return false;
+
+    task();
+    return true;
+}
+
+int ThreadPool::threadCount() const
+{
+    return (int)m_threads.size();
+}
+
+int ThreadPool::currentWorker() const
+{
+    return t_pool == this ? t_workerIndex : -1;
+}
+
+/*
+* Own queue is served in FIFO order so tasks that resubmit themselves don't
+* starve the rest of the queue. Other queues are robbed from the back.
+*/
+bool ThreadPool::popTask(const int index, Task &task)
+{
+    {
+        WorkerQueue &own = *m_queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.front());
+            own.tasks.pop_front();
+            m_pendingTasks--;
+            return true;
+        }
+    }
+
+    for (size_t i = 1; i < m_queues.size(); i++) {
+        WorkerQueue &victim = *m_queues[(index + i) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            m_pendingTasks--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::run(const int index)
+{
+    t_pool = this;
+    t_workerIndex = index;
+
+    Task task;
+    while (true) {
+        if (popTask(index, task)) {
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_wakeUp.wait(lock, [this] { return m_stopping || m_pendingTasks > 0; });
+        if (m_stopping && m_pendingTasks <= 0)
+            return;
+    }
+}
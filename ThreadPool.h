@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+* Work-stealing thread pool. Every worker has its own task queue; tasks
+* submitted from a worker go to that worker's queue and idle workers steal
+* from the others.
+*/
+class ThreadPool
+{
+public:
+    typedef std::function<void()> Task;
+
+    explicit ThreadPool(const int threadCount = 0);
+    ~ThreadPool();
+
+    void    submit(Task task);
+    bool    runPendingTask();
+    int     threadCount() const;
+
+private:
+    struct WorkerQueue
+    {
+        std::deque<Task>    tasks;
+        std::mutex          mutex;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>>   m_queues;
+    std::vector<std::thread>    m_threads;
+    std::atomic<long>           m_pendingTasks;
+    std::atomic<size_t>         m_nextQueue;
+    bool                        m_stopping = false;
+    std::mutex                  m_sleepMutex;
+    std::condition_variable     m_wakeUp;
+
+    int     currentWorker() const;
+    bool    popTask(const int index, Task &task);
+    void    run(const int index);
+};
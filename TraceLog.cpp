@@ -0,0 +1,133 @@
+#include "TraceLog.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+    /*
+    * Writes text as the contents of a JSON string. Track names are often file
+    * paths, which can hold backslashes and quotes.
+    */
+    void writeEscaped(std::ostream &json, const char *text)
+    {
+        for (; *text != 0; text++) {
+            char c = *text;
+            if (c == '"' || c == '\\') {
+                json << '\\' << c;
+            } else if ((unsigned char)c < 0x20) {
+                char code[8];
+                snprintf(code, sizeof(code), "\\u%04x", (unsigned char)c);
+                json << code;
+            } else {
+                json << c;
+            }
+        }
+    }
+}
+
+TraceLog::TraceLog(const size_t maxEvents)
+    : m_origin(std::chrono::steady_clock::now()), m_maxEvents(maxEvents)
+{
+}
+
+/*
+* name must outlive the log, stage names are string literals.
+*/
+void TraceLog::add(const char *name, const int track, const uint64 frame,
+    const std::chrono::steady_clock::time_point start, const std::chrono::steady_clock::time_point end)
+{
+    Event event;
+    event.name = name;
+    event.track = track;
+    event.frame = frame;
+    event.start = std::chrono::duration_cast<std::chrono::nanoseconds>(start - m_origin).count();
+    event.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_events.size() >= m_maxEvents) {
+        m_droppedEvents++;
+        return;
+    }
+    m_events.push_back(event);
+}
+
+/*
+* Label of the row of track in the trace viewer, e.g. the stream name.
+*/
+void TraceLog::setTrackName(const int track, const std::string name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto &trackName : m_trackNames) {
+        if (trackName.first == track) {
+            trackName.second = name;
+            return;
+        }
+    }
+    m_trackNames.push_back(std::make_pair(track, name));
+}
+
+void TraceLog::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_events.clear();
+    m_droppedEvents = 0;
+}
+
+size_t TraceLog::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_events.size();
+}
+
+uint64 TraceLog::droppedEvents() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_droppedEvents;
+}
+
+/*
+* Trace event format with complete ("X") events, timestamps in microseconds.
+* Track and stage names are escaped.
+*/
+std::string TraceLog::toJson() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::ostringstream json;
+    json.setf(std::ios::fixed);
+    json.precision(3);
+    json << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    bool first = true;
+    for (const auto &trackName : m_trackNames) {
+        json << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << trackName.first
+            << ",\"args\":{\"name\":\"";
+        writeEscaped(json, trackName.second.c_str());
+        json << "\"}}";
+        first = false;
+    }
+    for (const auto &event : m_events) {
+        json << (first ? "" : ",") << "\n{\"name\":\"";
+        writeEscaped(json, event.name);
+        json << "\",\"cat\":\"face_detector\",\"ph\":\"X\""
+            << ",\"pid\":1,\"tid\":" << event.track
+            << ",\"ts\":" << event.start / 1e3 << ",\"dur\":" << event.duration / 1e3
+            << ",\"args\":{\"frame\":" << event.frame << "}}";
+        first = false;
+    }
+    json << "\n]}";
+    return json.str();
+}
+
+bool TraceLog::save(const std::string filePath) const
+{
+    std::ofstream file(filePath.c_str(), std::ios::binary);
+    if (!file) {
+        std::cerr << "Error opening trace file " << filePath << std::endl;
+        return false;
+    }
+    file << toJson();
+    return (bool)file;
+}
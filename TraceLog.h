@@ -0,0 +1,47 @@
+#pragma once
+
+#include <opencv2\core.hpp>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+* Collects timed spans as Chrome trace events (chrome://tracing, Perfetto).
+* Every span belongs to a track, shown as a thread row, and is tagged with
+* the sequence number of its frame. Spans can be added from any thread, so
+* many detectors can share one log. Spans beyond maxEvents are dropped and
+* counted.
+*/
+class TraceLog
+{
+public:
+    explicit TraceLog(const size_t maxEvents = 1 << 20);
+
+    void        add(const char *name, const int track, const uint64 frame,
+                    const std::chrono::steady_clock::time_point start, const std::chrono::steady_clock::time_point end);
+    void        setTrackName(const int track, const std::string name);
+    void        clear();
+    size_t      size() const;
+    uint64      droppedEvents() const;
+    std::string toJson() const;
+    bool        save(const std::string filePath) const;
+
+private:
+    struct Event
+    {
+        const char* name;
+        int         track;
+        uint64      frame;
+        int64       start;      // Nanoseconds since the log was created
+        int64       duration;
+    };
+
+    std::chrono::steady_clock::time_point           m_origin;
+    size_t                                          m_maxEvents;
+    std::vector<Event>                              m_events;
+    std::vector<std::pair<int, std::string>>        m_trackNames;
+    uint64                                          m_droppedEvents = 0;
+    mutable std::mutex                              m_mutex;
+};
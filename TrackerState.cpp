@@ -0,0 +1,96 @@
+#include "TrackerState.h"
+
+namespace
+{
+    // Counts vector as allocated if it grew past the capacity seen last time
+    template<class T>
+    void countGrowth(const std::vector<T> &vector, std::vector<size_t> &capacities, size_t &index, uint64 &allocations)
+    {
+        if (index == capacities.size())
+            capacities.push_back(0);
+        if (vector.capacity() > capacities[index]) {
+            capacities[index] = vector.capacity();
+            allocations++;
+        }
+        index++;
+    }
+}
+
+TrackerState::TrackerState()
+    : allocations(new uint64(0)), changeDetector(allocations.get()), searchMask(allocations.get()),
+    stats(new DetectorStats()),
+    resizedFrameBuffer(allocations.get()), grayFrameBuffer(allocations.get()),
+    pyramid(1.1, allocations.get()), haarEvaluator(HaarEvaluator::frontalFace(), allocations.get()),
+    scan(new Scan())
+{
+    tracks.reserve(maxTrackedFaces);
+    freeTrackers.reserve(maxTrackedFaces);
+    freeMotionModels.reserve(maxTrackedFaces);
+}
+
+/*
+* Tracked faces in frame coordinates.
+*/
+std::vector<TrackedFace> TrackerState::faces() const
+{
+    std::vector<TrackedFace> trackedFaces;
+    trackedFaces.reserve(tracks.size());
+    for (const auto &track : tracks) {
+        TrackedFace trackedFace;
+        trackedFace.id = track.id;
+        trackedFace.face = scaledRect(track.face);
+        trackedFace.position.x = (int)(track.position.x / scale);
+        trackedFace.position.y = (int)(track.position.y / scale);
+        trackedFace.state = track.state;
+        trackedFace.confidence = track.confidence;
+        trackedFaces.push_back(trackedFace);
+    }
+    return trackedFaces;
+}
+
+/*
+* Converts a rect of the resized frame to frame coordinates.
+*/
+cv::Rect TrackerState::scaledRect(const cv::Rect &rect) const
+{
+    cv::Rect faceRect;
+    faceRect.x = (int)(rect.x / scale);
+    faceRect.y = (int)(rect.y / scale);
+    faceRect.width = (int)(rect.width / scale);
+    faceRect.height = (int)(rect.height / scale);
+    return faceRect;
+}
+
+/*
+* Number of times a per-frame buffer had to be (re)allocated. It stops
+* growing once the buffers are sized for the stream.
+*/
+uint64 TrackerState::bufferAllocations() const
+{
+    uint64 total = *allocations;
+    for (const auto &slot : scan->slots)
+        total += slot->allocations;
+    return total;
+}
+
+/*
+* Adds the per-frame vectors that grew since the last call to the allocation
+* counter, so bufferAllocations() covers them as well as the image buffers.
+*/
+void TrackerState::countVectorGrowth()
+{
+    size_t index = 0;
+    countGrowth(tracks, vectorCapacities, index, *allocations);
+    countGrowth(freeTrackers, vectorCapacities, index, *allocations);
+    countGrowth(freeMotionModels, vectorCapacities, index, *allocations);
+    countGrowth(allFaces, vectorCapacities, index, *allocations);
+    countGrowth(levelFaces, vectorCapacities, index, *allocations);
+    countGrowth(faceTracks, vectorCapacities, index, *allocations);
+    countGrowth(trackFaces, vectorCapacities, index, *allocations);
+    countGrowth(groupParents, vectorCapacities, index, *allocations);
+    countGrowth(groupRects, vectorCapacities, index, *allocations);
+    countGrowth(groupSizes, vectorCapacities, index, *allocations);
+    countGrowth(scan->jobs, vectorCapacities, index, *allocations);
+    for (const auto &job : scan->jobs)
+        countGrowth(job.faces, vectorCapacities, index, *allocations);
+}
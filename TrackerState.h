@@ -0,0 +1,159 @@
+#pragma once
+
+#include <opencv2\core.hpp>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "CadenceScheduler.h"
+#include "ChangeDetector.h"
+#include "DetectorStats.h"
+#include "FaceTracker.h"
+#include "FrameStamp.h"
+#include "HaarEvaluator.h"
+#include "ImageBuffer.h"
+#include "ImagePyramid.h"
+#include "MotionModel.h"
+#include "ResolutionController.h"
+#include "SearchMask.h"
+#include "ThreadPool.h"
+
+/*
+* Cascade that runs. OpenCV runs the loaded cascade file, with HaarEvaluator
+* if it's a Haar cascade of stumps and with cv::CascadeClassifier otherwise.
+* Compiled runs HaarEvaluator with the frontal face cascade compiled in at
+* build time.
+*/
+enum CascadeBackend
+{
+    CascadeBackendOpenCV,
+    CascadeBackendCompiled
+};
+
+struct TrackedFace
+{
+    int             id;
+    cv::Rect        face;
+    cv::Point       position;
+    TrackingState   state;      // Path that found the face in the last frame
+    double          confidence; // Tracking confidence of the template match, 1 for cascade detections
+};
+
+/*
+* Everything one stream changes while it is tracked: its settings, tracks,
+* per-frame buffers and statistics. FaceDetectorCore reads and updates it
+* for every frame. It is a movable value, so streams can be handed between
+* worker threads, but a state must only be used by one thread at a time.
+* The allocation counter, statistics and parallel scan state live behind
+* pointers, so buffers and pool tasks keep pointing at them after a move.
+* Per-frame vectors are counted when they grow, by countVectorGrowth().
+*/
+struct TrackerState
+{
+    struct Track
+    {
+        int         id = 0;
+        cv::Rect    face;
+        cv::Rect    roi;
+        std::unique_ptr<FaceTracker> tracker;
+        cv::Point   position;
+        MotionModel motion;
+        double      confidence = 1;
+        TrackingState state = FullFrameDetection;
+        bool        templateMatchingRunning = false;
+        double      templateMatchingStart = 0;  // Timestamp of the first template matching frame
+        int         framesSinceCascade = 0;
+        bool        lost = false;
+    };
+
+    // Band of window rows of one pyramid level in a parallel full frame scan
+    struct ScanJob
+    {
+        int                     level;
+        cv::Mat                 sum;        // Integrals of the searched part of the level
+        cv::Mat                 squareSum;
+        cv::Mat                 mask;       // Search area of the searched part, empty without search mask
+        cv::Point               origin;     // Searched part in the level
+        int                     firstRow;
+        int                     endRow;
+        std::vector<cv::Rect>   faces;
+    };
+
+    // Per-task state of a parallel scan, allocations are counted per slot
+    struct ScanSlot
+    {
+        uint64                          allocations = 0;
+        std::unique_ptr<HaarEvaluator>  evaluator;
+    };
+
+    struct Scan
+    {
+        std::vector<ScanJob>                    jobs;
+        std::vector<ImageBuffer>                integralBuffers;    // Per level, sum rows above squared sum rows
+        std::vector<std::unique_ptr<ScanSlot>>  slots;
+        std::atomic<size_t>                     nextJob;
+        std::atomic<int>                        runningTasks;
+
+        Scan() : nextJob(0), runningTasks(0) {}
+    };
+
+    TrackerState();
+
+    std::vector<TrackedFace>    faces() const;
+    cv::Rect                    scaledRect(const cv::Rect &rect) const;
+    uint64                      bufferAllocations() const;
+    void                        countVectorGrowth();
+
+    // Settings
+    int                     resizedWidth = 320;
+    bool                    adaptiveResolution = false;
+    CascadeBackend          cascadeBackend = CascadeBackendOpenCV;
+    TrackerBackend          trackerBackend = TrackerBackendTemplate;
+    int                     scanConcurrency = 1;
+    ThreadPool*             scanPool = NULL;
+    bool                    motionPrediction = true;
+    double                  minTrackingConfidence = 0.8;
+    double                  highTrackingConfidence = 0.9;
+    double                  lostTrackingConfidence = 0.5;
+    double                  frameRate = 30;
+    double                  templateMatchingMaxDuration = 3;
+    int                     maxTrackedFaces = 1;
+    int                     newFaceScanInterval = 10;
+    bool                    changeGate = false;
+    int                     maxSkippedScans = 30;
+    bool                    forceTrackingState = false;
+    TrackingState           forcedTrackingState = FullFrameDetection;
+
+    // Tracking
+    std::unique_ptr<uint64> allocations;
+    std::vector<Track>      tracks;
+    std::vector<std::unique_ptr<FaceTracker>> freeTrackers;
+    std::vector<MotionModel> freeMotionModels;
+    int                     nextTrackId = 1;
+    FrameStamp              frameStamp;     // Stamp of the last processed frame
+    double                  scale = 1;
+    int                     workingWidth = 0;
+    int                     framesSinceFullScan = 0;
+    int                     skippedScans = 0;
+    CadenceScheduler        scheduler;
+    ChangeDetector          changeDetector;
+    ResolutionController    resolutionController;
+    SearchMask              searchMask;
+    std::unique_ptr<DetectorStats> stats;
+
+    // Per-frame buffers
+    ImageBuffer             resizedFrameBuffer;
+    ImageBuffer             grayFrameBuffer;
+    ImagePyramid            pyramid;
+    HaarEvaluator           haarEvaluator;
+    std::vector<cv::Rect>   allFaces;
+    std::vector<cv::Rect>   levelFaces;
+    std::vector<int>        faceTracks;     // Track matched to every detection of allFaces, -1 if none
+    std::vector<int>        trackFaces;     // Detection matched to every track, -1 if none
+    std::vector<int>        groupParents;   // Grouping of allFaces, see FaceDetectorCore::groupFaces()
+    std::vector<cv::Rect>   groupRects;
+    std::vector<int>        groupSizes;
+    std::vector<size_t>     vectorCapacities;   // Capacities seen by the last countVectorGrowth()
+    std::unique_ptr<Scan>   scan;
+};
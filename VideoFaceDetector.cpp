@@ -1,18 +1,47 @@
 #include "VideoFaceDetector.h"
+#include <chrono>
 #include <iostream>
-#include <opencv2\imgproc.hpp>
-
-const double VideoFaceDetector::TICK_FREQUENCY = cv::getTickFrequency();
 
 VideoFaceDetector::VideoFaceDetector(const std::string cascadeFilePath, cv::VideoCapture &videoCapture)
+    : m_core(std::make_shared<const FaceDetectorCore>(cascadeFilePath))
+{
+    setVideoCapture(videoCapture);
+}
+
+/*
+* Detector without a capture, frames are pushed with detect().
+*/
+VideoFaceDetector::VideoFaceDetector(const std::string cascadeFilePath)
+    : m_core(std::make_shared<const FaceDetectorCore>(cascadeFilePath))
+{
+}
+
+/*
+* Detectors built from the same core share its cascade and only keep their
+* own tracker state, so many streams can be followed with one loaded cascade.
+*/
+VideoFaceDetector::VideoFaceDetector(std::shared_ptr<const FaceDetectorCore> core, cv::VideoCapture &videoCapture)
+    : m_core(core)
 {
-    setFaceCascade(cascadeFilePath);
     setVideoCapture(videoCapture);
 }
 
+VideoFaceDetector::VideoFaceDetector(std::shared_ptr<const FaceDetectorCore> core)
+    : m_core(core)
+{
+}
+
 void VideoFaceDetector::setVideoCapture(cv::VideoCapture &videoCapture)
 {
     m_videoCapture = &videoCapture;
+
+    double fps = videoCapture.get(cv::CAP_PROP_FPS);
+    if (fps > 0)
+        m_state.frameRate = fps;
+
+    // Restart capture thread on the new source
+    if (m_captureThread != NULL)
+        setPipelinedCapture(true, m_captureQueueSize, m_captureOverflowPolicy);
 }
 
 cv::VideoCapture *VideoFaceDetector::videoCapture() const
@@ -20,278 +49,564 @@ cv::VideoCapture *VideoFaceDetector::videoCapture() const
     return m_videoCapture;
 }
 
+/*
+* Replaces the core with one running the cascade of cascadeFilePath. Tracks
+* and settings of the stream are kept.
+*/
 void VideoFaceDetector::setFaceCascade(const std::string cascadeFilePath)
 {
-    if (m_faceCascade == NULL) {
-        m_faceCascade = new cv::CascadeClassifier(cascadeFilePath);
-    }
-    else {
-        m_faceCascade->load(cascadeFilePath);
-    }
-
-    if (m_faceCascade->empty()) {
-        std::cerr << "Error creating cascade classifier. Make sure the file" << std::endl
-            << cascadeFilePath << " exists." << std::endl;
-    }
+    m_core = std::make_shared<const FaceDetectorCore>(cascadeFilePath);
+    checkScanConcurrency();
 }
 
+/*
+* Returns the calling thread's instance of the shared cascade.
+*/
 cv::CascadeClassifier *VideoFaceDetector::faceCascade() const
 {
-    return m_faceCascade;
+    return m_core->faceCascade();
 }
 
 void VideoFaceDetector::setResizedWidth(const int width)
 {
-    m_resizedWidth = std::max(width, 1);
+    m_state.resizedWidth = std::max(width, 1);
+    m_state.resolutionController.reset(m_state.resizedWidth);
 }
 
 int VideoFaceDetector::resizedWidth() const
 {
-    return m_resizedWidth;
+    return m_state.resizedWidth;
+}
+
+/*
+* Width of the resized frame of the last frame, which differs from
+* resizedWidth() with adaptive resolution or frames narrower than it.
+*/
+int VideoFaceDetector::workingWidth() const
+{
+    return m_state.workingWidth;
+}
+
+/*
+* With adaptive resolution the resolution controller picks the resized width
+* and the face sizes of full frame scans every frame, starting from
+* resizedWidth(). Tracks are rescaled when the width changes, so face() and
+* facePosition() stay in frame coordinates.
+*/
+void VideoFaceDetector::setAdaptiveResolution(const bool enabled)
+{
+    m_state.adaptiveResolution = enabled;
+    m_state.resolutionController.reset(m_state.resizedWidth);
+}
+
+bool VideoFaceDetector::adaptiveResolution() const
+{
+    return m_state.adaptiveResolution;
+}
+
+/*
+* Width range, target face height and frame time budget of adaptive resolution.
+*/
+ResolutionController &VideoFaceDetector::resolutionController()
+{
+    return m_state.resolutionController;
 }
 
 bool VideoFaceDetector::isFaceFound() const
 {
-	return m_foundFace;
+	return !m_state.tracks.empty();
 }
 
 cv::Rect VideoFaceDetector::face() const
 {
-    cv::Rect faceRect = m_trackedFace;
-    faceRect.x = (int)(faceRect.x / m_scale);
-    faceRect.y = (int)(faceRect.y / m_scale);
-    faceRect.width = (int)(faceRect.width / m_scale);
-    faceRect.height = (int)(faceRect.height / m_scale);
-    return faceRect;
+    if (m_state.tracks.empty())
+        return cv::Rect();
+    return m_state.scaledRect(m_state.tracks[0].face);
 }
 
 cv::Point VideoFaceDetector::facePosition() const
 {
+    if (m_state.tracks.empty())
+        return cv::Point();
     cv::Point facePos;
-    facePos.x = (int)(m_facePosition.x / m_scale);
-    facePos.y = (int)(m_facePosition.y / m_scale);
+    facePos.x = (int)(m_state.tracks[0].position.x / m_state.scale);
+    facePos.y = (int)(m_state.tracks[0].position.y / m_state.scale);
     return facePos;
 }
 
+std::vector<TrackedFace> VideoFaceDetector::faces() const
+{
+    return m_state.faces();
+}
+
 void VideoFaceDetector::setTemplateMatchingMaxDuration(const double s)
 {
-    m_templateMatchingMaxDuration = s;
+    m_state.templateMatchingMaxDuration = s;
 }
 
 double VideoFaceDetector::templateMatchingMaxDuration() const
 {
-    return m_templateMatchingMaxDuration;
+    return m_state.templateMatchingMaxDuration;
 }
 
-VideoFaceDetector::~VideoFaceDetector()
+void VideoFaceDetector::setMaxTrackedFaces(const int count)
 {
-    if (m_faceCascade != NULL) {
-        delete m_faceCascade;
-    }
+    m_state.maxTrackedFaces = std::max(count, 1);
+    m_state.tracks.reserve(m_state.maxTrackedFaces);
+    m_state.freeTrackers.reserve(m_state.maxTrackedFaces);
+    m_state.freeMotionModels.reserve(m_state.maxTrackedFaces);
 }
 
-cv::Rect VideoFaceDetector::doubleRectSize(const cv::Rect &inputRect, const cv::Rect &frameSize) const
+int VideoFaceDetector::maxTrackedFaces() const
 {
-    cv::Rect outputRect;
-    // Double rect size
-    outputRect.width = inputRect.width * 2;
-    outputRect.height = inputRect.height * 2;
+    return m_state.maxTrackedFaces;
+}
 
-    // Center rect around original center
-    outputRect.x = inputRect.x - inputRect.width / 2;
-    outputRect.y = inputRect.y - inputRect.height / 2;
+void VideoFaceDetector::setNewFaceScanInterval(const int frames)
+{
+    m_state.newFaceScanInterval = std::max(frames, 1);
+}
 
-    // Handle edge cases
-    if (outputRect.x < frameSize.x) {
-        outputRect.width += outputRect.x;
-        outputRect.x = frameSize.x;
-    }
-    if (outputRect.y < frameSize.y) {
-        outputRect.height += outputRect.y;
-        outputRect.y = frameSize.y;
-    }
+int VideoFaceDetector::newFaceScanInterval() const
+{
+    return m_state.newFaceScanInterval;
+}
 
-    if (outputRect.x + outputRect.width > frameSize.width) {
-        outputRect.width = frameSize.width - outputRect.x;
-    }
-    if (outputRect.y + outputRect.height > frameSize.height) {
-        outputRect.height = frameSize.height - outputRect.y;
-    }
+/*
+* In pipelined mode frames are read by a separate capture thread into a ring
+* of queueSize frames, so capture time overlaps with detection. The frame
+* passed to getFrameAndDetect() is swapped with the captured one and goes
+* back into the ring.
+*/
+void VideoFaceDetector::setPipelinedCapture(const bool enabled, const size_t queueSize,
+    const FrameQueue::OverflowPolicy policy)
+{
+    m_captureThread.reset();
+
+    m_captureQueueSize = queueSize;
+    m_captureOverflowPolicy = policy;
 
-    return outputRect;
+    if (enabled && m_videoCapture != NULL)
+        m_captureThread.reset(new CaptureThread(*m_videoCapture, queueSize, policy));
 }
 
-cv::Point VideoFaceDetector::centerOfRect(const cv::Rect &rect) const
+bool VideoFaceDetector::pipelinedCapture() const
 {
-    return cv::Point(rect.x + rect.width / 2, rect.y + rect.height / 2);
+    return m_captureThread != NULL;
 }
 
-cv::Rect VideoFaceDetector::biggestFace(std::vector<cv::Rect> &faces) const
+const FrameQueue *VideoFaceDetector::frameQueue() const
 {
-    assert(!faces.empty());
+    return m_captureThread != NULL ? &m_captureThread->queue() : NULL;
+}
 
-    cv::Rect *biggest = &faces[0];
-    for (auto &face : faces) {
-        if (face.area() < biggest->area())
-            biggest = &face;
-    }
-    return *biggest;
+/*
+* Number of times a per-frame buffer had to be (re)allocated. It stops
+* growing once the buffers are sized for the stream.
+*/
+uint64 VideoFaceDetector::bufferAllocations() const
+{
+    return m_state.bufferAllocations();
+}
+
+/*
+* With motion prediction each track runs a constant velocity Kalman filter and
+* the search ROI is centered on the predicted position and sized by its
+* uncertainty. Without it the ROI is twice the last face, centered on it.
+*/
+void VideoFaceDetector::setMotionPrediction(const bool enabled)
+{
+    m_state.motionPrediction = enabled;
+}
+
+bool VideoFaceDetector::motionPrediction() const
+{
+    return m_state.motionPrediction;
+}
+
+/*
+* Per-frame detection time budget in seconds. While faces are tracked the
+* cascade then runs only every N frames, with N chosen from measured frame
+* times, and template matching tracks faces in between. 0 runs the cascade
+* on every frame.
+*/
+void VideoFaceDetector::setFrameTimeBudget(const double s)
+{
+    m_state.scheduler.setFrameTimeBudget(s);
+}
+
+double VideoFaceDetector::frameTimeBudget() const
+{
+    return m_state.scheduler.frameTimeBudget();
+}
+
+void VideoFaceDetector::setMaxCascadeInterval(const int frames)
+{
+    m_state.scheduler.setMaxInterval(frames);
+}
+
+int VideoFaceDetector::maxCascadeInterval() const
+{
+    return m_state.scheduler.maxInterval();
+}
+
+int VideoFaceDetector::cascadeInterval() const
+{
+    return m_state.scheduler.interval();
 }
 
 /*
-* Face template is small patch in the middle of detected face.
+* Faces followed by their tracker with lower confidence are redetected
+* using cascades on the next frame regardless of the cascade interval.
 */
-cv::Mat VideoFaceDetector::getFaceTemplate(const cv::Mat &frame, cv::Rect face)
+void VideoFaceDetector::setMinTrackingConfidence(const double confidence)
 {
-    face.x += face.width / 4;
-    face.y += face.height / 4;
-    face.width /= 2;
-    face.height /= 2;
+    m_state.minTrackingConfidence = confidence;
+}
 
-    cv::Mat faceTemplate = frame(face).clone();
-    return faceTemplate;
+double VideoFaceDetector::minTrackingConfidence() const
+{
+    return m_state.minTrackingConfidence;
 }
 
-void VideoFaceDetector::detectFaceAllSizes(const cv::Mat &frame)
+/*
+* Tracks followed by their tracker with at least this confidence skip the ROI
+* cascade and don't refresh the tracker. They are still confirmed by the cascade
+* every maxCascadeInterval() frames.
+*/
+void VideoFaceDetector::setHighTrackingConfidence(const double confidence)
 {
-    // Minimum face size is 1/5th of screen height
-    // Maximum face size is 2/3rds of screen height
-    m_faceCascade->detectMultiScale(frame, m_allFaces, 1.1, 3, 0,
-        cv::Size(frame.rows / 5, frame.rows / 5),
-        cv::Size(frame.rows * 2 / 3, frame.rows * 2 / 3));
+    m_state.highTrackingConfidence = confidence;
+}
 
-    if (m_allFaces.empty()) return;
+double VideoFaceDetector::highTrackingConfidence() const
+{
+    return m_state.highTrackingConfidence;
+}
 
-    m_foundFace = true;
+/*
+* Tracks followed by their tracker with less than this confidence are dropped
+* right away instead of waiting for the template matching max duration.
+*/
+void VideoFaceDetector::setLostTrackingConfidence(const double confidence)
+{
+    m_state.lostTrackingConfidence = confidence;
+}
 
-    // Locate biggest face
-    m_trackedFace = biggestFace(m_allFaces);
+double VideoFaceDetector::lostTrackingConfidence() const
+{
+    return m_state.lostTrackingConfidence;
+}
 
-    // Copy face template
-    m_faceTemplate = getFaceTemplate(frame, m_trackedFace);
+/*
+* Frame rate used to time frames without a capture timestamp, or with one not
+* after the last frame's. Taken from the video capture when it reports one,
+* 30 otherwise.
+*/
+void VideoFaceDetector::setFrameRate(const double fps)
+{
+    if (fps > 0)
+        m_state.frameRate = fps;
+}
 
-    // Calculate roi
-    m_faceRoi = doubleRectSize(m_trackedFace, cv::Rect(0, 0, frame.cols, frame.rows));
+double VideoFaceDetector::frameRate() const
+{
+    return m_state.frameRate;
+}
 
-    // Update face position
-    m_facePosition = centerOfRect(m_trackedFace);
+/*
+* Splits full frame scans into bands of pyramid levels and runs up to tasks of
+* them at once on pool, or on a pool shared by all detectors if none is given.
+* The calling thread scans too and runs other pool tasks while it waits, so
+* detectors running on pool threads can use the same pool. Results don't
+* depend on the concurrency. 1 (default) scans on the calling thread only.
+* Only Haar cascades are split; other cascades loaded for the OpenCV backend
+* scan on the calling thread, which is reported when the concurrency is set
+* or the cascade changes.
+*/
+void VideoFaceDetector::setScanConcurrency(const int tasks, ThreadPool *pool)
+{
+    FaceDetectorCore::setScanConcurrency(m_state, tasks, pool);
+    checkScanConcurrency();
 }
 
-void VideoFaceDetector::detectFaceAroundRoi(const cv::Mat &frame)
+int VideoFaceDetector::scanConcurrency() const
 {
-    // Detect faces sized +/-20% off biggest face in previous search
-    m_faceCascade->detectMultiScale(frame(m_faceRoi), m_allFaces, 1.1, 3, 0,
-        cv::Size(m_trackedFace.width * 8 / 10, m_trackedFace.height * 8 / 10),
-        cv::Size(m_trackedFace.width * 12 / 10, m_trackedFace.width * 12 / 10));
+    return m_state.scanConcurrency;
+}
 
-    if (m_allFaces.empty())
-    {
-        // Activate template matching if not already started and start timer
-        m_templateMatchingRunning = true;
-        if (m_templateMatchingStartTime == 0)
-            m_templateMatchingStartTime = cv::getTickCount();
-        return;
+void VideoFaceDetector::checkScanConcurrency() const
+{
+    if (m_state.scanConcurrency > 1 && !m_core->empty() && !m_core->splitsScans(m_state)) {
+        std::cerr << "Scan concurrency " << m_state.scanConcurrency << " has no effect: " << m_core->cascadeFilePath()
+            << " isn't a Haar cascade of stumps, so full frame scans run on the calling thread." << std::endl;
     }
+}
+
+/*
+* Appends the results of a processed frame to the result log, if one is set.
+* An empty frame is the end of the stream and isn't logged.
+*/
+void VideoFaceDetector::logResults(const cv::Mat &frame)
+{
+    if (m_resultLog != NULL && !frame.empty())
+        m_resultLog->append((int64)m_state.frameStamp.sequence, m_state.frameStamp.timestamp, faces());
+}
+
+/*
+* CascadeBackendCompiled runs the built-in frontal face cascade compiled into
+* the library instead of the loaded cascade file, always over the shared
+* pyramid.
+*/
+void VideoFaceDetector::setCascadeBackend(const CascadeBackend backend)
+{
+    m_state.cascadeBackend = backend;
+    checkScanConcurrency();
+}
+
+CascadeBackend VideoFaceDetector::cascadeBackend() const
+{
+    return m_state.cascadeBackend;
+}
+
+/*
+* Tracker following faces between cascade detections. Tracked faces are
+* dropped and found again by the next full frame scan.
+*/
+void VideoFaceDetector::setTrackerBackend(const TrackerBackend backend)
+{
+    m_state.tracks.clear();
+    m_state.freeTrackers.clear();
+    m_state.trackerBackend = backend;
+}
+
+TrackerBackend VideoFaceDetector::trackerBackend() const
+{
+    return m_state.trackerBackend;
+}
 
-    // Turn off template matching if running and reset timer
-    m_templateMatchingRunning = false;
-    m_templateMatchingCurrentTime = m_templateMatchingStartTime = 0;
+/*
+* Tells the detector how to read captured frames. Every stage after the
+* downscale works on a single channel whatever the input format is.
+*/
+void VideoFaceDetector::setInputFormat(const PixelFormat format)
+{
+    m_inputFormat = format;
+}
 
-    // Get detected face
-    m_trackedFace = biggestFace(m_allFaces);
+PixelFormat VideoFaceDetector::inputFormat() const
+{
+    return m_inputFormat;
+}
 
-    // Add roi offset to face
-    m_trackedFace.x += m_faceRoi.x;
-    m_trackedFace.y += m_faceRoi.y;
+/*
+* With the gate on, a frame without tracked faces is only scanned if it
+* differs from the frame of the last scan, and only around the changed area
+* when the change is small. Static frames are rescanned after maxSkippedScans
+* frames anyway in case a face was missed.
+*/
+void VideoFaceDetector::setChangeGate(const bool enabled, const int maxSkippedScans)
+{
+    m_state.changeGate = enabled;
+    m_state.maxSkippedScans = std::max(maxSkippedScans, 0);
+    m_state.skippedScans = 0;
+    m_state.changeDetector.reset();
+}
 
-    // Get face template
-    m_faceTemplate = getFaceTemplate(frame, m_trackedFace);
+bool VideoFaceDetector::changeGate() const
+{
+    return m_state.changeGate;
+}
 
-    // Calculate roi
-    m_faceRoi = doubleRectSize(m_trackedFace, cv::Rect(0, 0, frame.cols, frame.rows));
+/*
+* Cell size and threshold of the change detection gate.
+*/
+ChangeDetector &VideoFaceDetector::changeDetector()
+{
+    return m_state.changeDetector;
+}
 
-    // Update face position
-    m_facePosition = centerOfRect(m_trackedFace);
+/*
+* Inclusion and exclusion areas of the stream in frame pixels. Cascade windows
+* centered outside the searched area are never evaluated, by full frame and
+* ROI searches alike, and faces found and tracks moving outside it are
+* dropped. Cascades detectMultiScale has to run (not Haar) are only cut to
+* the area's bounding box.
+*/
+SearchMask &VideoFaceDetector::searchMask()
+{
+    return m_state.searchMask;
 }
 
-void VideoFaceDetector::detectFacesTemplateMatching(const cv::Mat &frame)
+/*
+* Restricts tracking to a single path, mainly for benchmarking. FullFrameDetection
+* runs the cascade over the whole frame every frame, RoiDetection never falls
+* back to template matching and TemplateMatching skips the ROI cascade once a
+* face has been found.
+*/
+void VideoFaceDetector::setForcedTrackingState(const bool forced, const TrackingState state)
 {
-    // Calculate duration of template matching
-    m_templateMatchingCurrentTime = cv::getTickCount();
-    double duration = (double)(m_templateMatchingCurrentTime - m_templateMatchingStartTime) / TICK_FREQUENCY;
+    m_state.forceTrackingState = forced;
+    m_state.forcedTrackingState = state;
+}
 
-    // If template matching lasts for more than 2 seconds face is possibly lost
-    // so disable it and redetect using cascades
-    if (duration > m_templateMatchingMaxDuration) {
-        m_foundFace = false;
-        m_templateMatchingRunning = false;
-        m_templateMatchingStartTime = m_templateMatchingCurrentTime = 0;
-		m_facePosition.x = m_facePosition.y = 0;
-		m_trackedFace.x = m_trackedFace.y = m_trackedFace.width = m_trackedFace.height = 0;
-		return;
-    }
+bool VideoFaceDetector::isTrackingStateForced() const
+{
+    return m_state.forceTrackingState;
+}
 
-	// Edge case when face exits frame while 
-	if (m_faceTemplate.rows * m_faceTemplate.cols == 0 || m_faceTemplate.rows <= 1 || m_faceTemplate.cols <= 1) {
-		m_foundFace = false;
-		m_templateMatchingRunning = false;
-		m_templateMatchingStartTime = m_templateMatchingCurrentTime = 0;
-		m_facePosition.x = m_facePosition.y = 0;
-		m_trackedFace.x = m_trackedFace.y = m_trackedFace.width = m_trackedFace.height = 0;
-		return;
-	}
+/*
+* Per-stage latencies and tracking state counters. Cheap enough to be always on.
+*/
+const DetectorStats &VideoFaceDetector::stats() const
+{
+    return *m_state.stats;
+}
 
-    // Template matching with last known face 
-    //cv::matchTemplate(frame(m_faceRoi), m_faceTemplate, m_matchingResult, CV_TM_CCOEFF);
-    cv::matchTemplate(frame(m_faceRoi), m_faceTemplate, m_matchingResult, CV_TM_SQDIFF_NORMED);
-    cv::normalize(m_matchingResult, m_matchingResult, 0, 1, cv::NORM_MINMAX, -1, cv::Mat());
-    double min, max;
-    cv::Point minLoc, maxLoc;
-    cv::minMaxLoc(m_matchingResult, &min, &max, &minLoc, &maxLoc);
+void VideoFaceDetector::resetStats()
+{
+    m_state.stats->reset();
+}
 
-    // Add roi offset to face position
-    minLoc.x += m_faceRoi.x;
-    minLoc.y += m_faceRoi.y;
+/*
+* Adds every stage of every frame as a span to trace, on the row of track.
+* NULL turns tracing off.
+*/
+void VideoFaceDetector::setTrace(TraceLog *trace, const int track)
+{
+    m_state.stats->setTrace(trace, track);
+}
 
-    // Get detected face
-    //m_trackedFace = cv::Rect(maxLoc.x, maxLoc.y, m_trackedFace.width, m_trackedFace.height);
-    m_trackedFace = cv::Rect(minLoc.x, minLoc.y, m_faceTemplate.cols, m_faceTemplate.rows);
-    m_trackedFace = doubleRectSize(m_trackedFace, cv::Rect(0, 0, frame.cols, frame.rows));
+/*
+* Appends the faces of every processed frame to log, with the frame's
+* sequence number and timestamp, and a marker record for frames without
+* faces. The log isn't owned and must stay open while it's set; NULL stops
+* logging.
+*/
+void VideoFaceDetector::setResultLog(ResultLogWriter *log)
+{
+    m_resultLog = log;
+}
 
-    // Get new face template
-    m_faceTemplate = getFaceTemplate(frame, m_trackedFace);
+ResultLogWriter *VideoFaceDetector::resultLog() const
+{
+    return m_resultLog;
+}
 
-    // Calculate face roi
-    m_faceRoi = doubleRectSize(m_trackedFace, cv::Rect(0, 0, frame.cols, frame.rows));
+/*
+* Sequence number, capture timestamp and capture time of the last processed
+* frame, which face(), facePosition() and faces() belong to.
+*/
+FrameStamp VideoFaceDetector::frameStamp() const
+{
+    return m_state.frameStamp;
+}
 
-    // Update face position
-    m_facePosition = centerOfRect(m_trackedFace);
+/*
+* Core running detection for this detector, shareable with other detectors.
+*/
+std::shared_ptr<const FaceDetectorCore> VideoFaceDetector::core() const
+{
+    return m_core;
 }
 
-cv::Point VideoFaceDetector::getFrameAndDetect(cv::Mat &frame)
+/*
+* Tracks, settings and buffers of the stream, for running it directly through
+* a FaceDetectorCore.
+*/
+TrackerState &VideoFaceDetector::trackerState()
 {
-    *m_videoCapture >> frame;
+    return m_state;
+}
 
-    // Downscale frame to m_resizedWidth width - keep aspect ratio
-    m_scale = (double) std::min(m_resizedWidth, frame.cols) / frame.cols;
-    cv::Size resizedFrameSize = cv::Size((int)(m_scale*frame.cols), (int)(m_scale*frame.rows));
+/*
+* Frames are stamped with their capture timestamp (CAP_PROP_POS_MSEC) and,
+* with pipelined capture, the sequence number given by the capture thread.
+*/
+cv::Point VideoFaceDetector::getFrameAndDetect(cv::Mat &frame)
+{
+    auto start = std::chrono::steady_clock::now();
 
-    cv::Mat resizedFrame;
-    cv::resize(frame, resizedFrame, resizedFrameSize);
+    if (m_videoCapture == NULL) {
+        std::cerr << "No video capture set, use detect() to push frames." << std::endl;
+        frame.release();
+        return cv::Point();
+    }
 
-    if (!m_foundFace)
-        detectFaceAllSizes(resizedFrame); // Detect using cascades over whole image
-    else {
-        detectFaceAroundRoi(resizedFrame); // Detect using cascades only in ROI
-        if (m_templateMatchingRunning) {
-            detectFacesTemplateMatching(resizedFrame); // Detect using template matching
+    FrameStamp stamp;
+    if (m_captureThread != NULL) {
+        // End of stream, the queue leaves the last frame in place
+        if (!m_captureThread->read(frame, &stamp)) {
+            frame.release();
+            return m_state.tracks.empty() ? cv::Point() : m_state.tracks[0].position;
         }
     }
+    else {
+        *m_videoCapture >> frame;
+        stamp = FrameStamp(m_state.frameStamp.sequence + 1, m_videoCapture->get(cv::CAP_PROP_POS_MSEC),
+            std::chrono::steady_clock::now());
+    }
+    m_state.stats->recordSpan(DetectorStats::Capture, start, std::chrono::steady_clock::now(), stamp.sequence);
 
-    return m_facePosition;
+    cv::Point position = m_core->process(m_state, frame, m_inputFormat, stamp);
+    m_state.stats->recordSpan(DetectorStats::Frame, start, std::chrono::steady_clock::now(), m_state.frameStamp.sequence);
+    logResults(frame);
+    return position;
+}
+
+/*
+* Runs detection and tracking on a frame from any source. The frame is only
+* read, and only during the call. timestamp is the capture timestamp of the
+* frame in milliseconds; without one frames are timed at frameRate().
+*/
+cv::Point VideoFaceDetector::detect(const cv::Mat &frame, const double timestamp)
+{
+    auto start = std::chrono::steady_clock::now();
+    cv::Point position = m_core->process(m_state, frame, m_inputFormat, FrameStamp(0, timestamp, start));
+    m_state.stats->recordSpan(DetectorStats::Frame, start, std::chrono::steady_clock::now(), m_state.frameStamp.sequence);
+    logResults(frame);
+    return position;
+}
+
+/*
+* Same for a frame captured elsewhere that already carries its stamp, like
+* frames read from a CaptureThread the caller runs itself.
+*/
+cv::Point VideoFaceDetector::detect(const cv::Mat &frame, const FrameStamp &stamp)
+{
+    auto start = std::chrono::steady_clock::now();
+    cv::Point position = m_core->process(m_state, frame, m_inputFormat, stamp);
+    m_state.stats->recordSpan(DetectorStats::Frame, start, std::chrono::steady_clock::now(), m_state.frameStamp.sequence);
+    logResults(frame);
+    return position;
+}
+
+/*
+* Runs detection directly on a caller owned buffer described by image, the
+* pixels are neither copied nor written. The format of the view is used
+* instead of inputFormat(), and face coordinates are in pixels of the view.
+*/
+cv::Point VideoFaceDetector::detect(const ImageView &image, const double timestamp)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    int type = image.format == PixelFormatBGR ? CV_8UC3 : image.format == PixelFormatBGRA ? CV_8UC4 : CV_8UC1;
+    if (image.data == NULL || image.size.area() <= 0 || image.step < (size_t)(image.size.width * CV_MAT_CN(type))) {
+        std::cerr << "Invalid image view " << image.size.width << "x" << image.size.height
+            << ", step " << image.step << std::endl;
+        return m_state.tracks.empty() ? cv::Point() : m_state.tracks[0].position;
+    }
+
+    // NV12 views only need their Y plane, which is a gray image of the view size
+    cv::Mat frame(image.size, type, const_cast<uchar*>(image.data), image.step);
+    cv::Point position = m_core->process(m_state, frame, image.format == PixelFormatNV12 ? PixelFormatGray : image.format,
+        FrameStamp(0, timestamp, start));
+    m_state.stats->recordSpan(DetectorStats::Frame, start, std::chrono::steady_clock::now(), m_state.frameStamp.sequence);
+    logResults(frame);
+    return position;
 }
 
 cv::Point VideoFaceDetector::operator>>(cv::Mat &frame)
 {
     return this->getFrameAndDetect(frame);
-}
\ No newline at end of file
+}
@@ -4,51 +4,122 @@
 #include <opencv2\highgui\highgui.hpp>
 #include <opencv2\objdetect\objdetect.hpp>
 
+#include <memory>
+#include <vector>
+
+#include "CaptureThread.h"
+#include "FaceDetectorCore.h"
+#include "ResultLog.h"
+
+/*
+* Caller owned 8-bit image. step is the distance between rows in bytes and
+* size is in pixels; for NV12 data points to the Y plane and size is the
+* luma size.
+*/
+struct ImageView
+{
+    const uchar*    data = NULL;
+    size_t          step = 0;
+    cv::Size        size;
+    PixelFormat     format = PixelFormatBGR;
+
+    ImageView() {}
+    ImageView(const uchar *data, const size_t step, const cv::Size size, const PixelFormat format)
+        : data(data), step(step), size(size), format(format) {}
+};
+
+/*
+* Follows faces in one stream: reads frames from a capture or takes them from
+* the caller and runs them through a FaceDetectorCore with its own TrackerState.
+*/
 class VideoFaceDetector
 {
 public:
     VideoFaceDetector(const std::string cascadeFilePath, cv::VideoCapture &videoCapture);
-    ~VideoFaceDetector();
+    explicit VideoFaceDetector(const std::string cascadeFilePath);
+    VideoFaceDetector(std::shared_ptr<const FaceDetectorCore> core, cv::VideoCapture &videoCapture);
+    explicit VideoFaceDetector(std::shared_ptr<const FaceDetectorCore> core);
+    VideoFaceDetector(VideoFaceDetector &&) = default;
+    VideoFaceDetector &operator=(VideoFaceDetector &&) = default;
 
     cv::Point               getFrameAndDetect(cv::Mat &frame);
     cv::Point               operator>>(cv::Mat &frame);
+    cv::Point               detect(const cv::Mat &frame, const double timestamp = -1);
+    cv::Point               detect(const cv::Mat &frame, const FrameStamp &stamp);
+    cv::Point               detect(const ImageView &image, const double timestamp = -1);
     void                    setVideoCapture(cv::VideoCapture &videoCapture);
     cv::VideoCapture*       videoCapture() const;
     void                    setFaceCascade(const std::string cascadeFilePath);
     cv::CascadeClassifier*  faceCascade() const;
     void                    setResizedWidth(const int width);
     int                     resizedWidth() const;
+    int                     workingWidth() const;
+    void                    setAdaptiveResolution(const bool enabled);
+    bool                    adaptiveResolution() const;
+    ResolutionController&   resolutionController();
 	bool					isFaceFound() const;
     cv::Rect                face() const;
     cv::Point               facePosition() const;
+    std::vector<TrackedFace> faces() const;
     void                    setTemplateMatchingMaxDuration(const double s);
     double                  templateMatchingMaxDuration() const;
+    void                    setMaxTrackedFaces(const int count);
+    int                     maxTrackedFaces() const;
+    void                    setNewFaceScanInterval(const int frames);
+    int                     newFaceScanInterval() const;
+    void                    setPipelinedCapture(const bool enabled, const size_t queueSize = 2,
+                                const FrameQueue::OverflowPolicy policy = FrameQueue::DropOldest);
+    bool                    pipelinedCapture() const;
+    const FrameQueue*       frameQueue() const;
+    uint64                  bufferAllocations() const;
+    void                    setMotionPrediction(const bool enabled);
+    bool                    motionPrediction() const;
+    void                    setFrameTimeBudget(const double s);
+    double                  frameTimeBudget() const;
+    void                    setMaxCascadeInterval(const int frames);
+    int                     maxCascadeInterval() const;
+    int                     cascadeInterval() const;
+    void                    setMinTrackingConfidence(const double confidence);
+    double                  minTrackingConfidence() const;
+    void                    setHighTrackingConfidence(const double confidence);
+    double                  highTrackingConfidence() const;
+    void                    setLostTrackingConfidence(const double confidence);
+    double                  lostTrackingConfidence() const;
+    void                    setFrameRate(const double fps);
+    double                  frameRate() const;
+    void                    setScanConcurrency(const int tasks, ThreadPool *pool = NULL);
+    int                     scanConcurrency() const;
+    void                    setCascadeBackend(const CascadeBackend backend);
+    CascadeBackend          cascadeBackend() const;
+    void                    setTrackerBackend(const TrackerBackend backend);
+    TrackerBackend          trackerBackend() const;
+    void                    setInputFormat(const PixelFormat format);
+    PixelFormat             inputFormat() const;
+    void                    setChangeGate(const bool enabled, const int maxSkippedScans = 30);
+    bool                    changeGate() const;
+    ChangeDetector&         changeDetector();
+    SearchMask&             searchMask();
+    void                    setForcedTrackingState(const bool forced, const TrackingState state = FullFrameDetection);
+    bool                    isTrackingStateForced() const;
+    const DetectorStats&    stats() const;
+    void                    resetStats();
+    void                    setTrace(TraceLog *trace, const int track = 0);
+    void                    setResultLog(ResultLogWriter *log);
+    ResultLogWriter*        resultLog() const;
+    FrameStamp              frameStamp() const;
+    std::shared_ptr<const FaceDetectorCore> core() const;
+    TrackerState&           trackerState();
 
 private:
-    static const double     TICK_FREQUENCY;
-
+    std::shared_ptr<const FaceDetectorCore> m_core;
+    TrackerState            m_state;
     cv::VideoCapture*       m_videoCapture = NULL;
-    cv::CascadeClassifier*  m_faceCascade = NULL;
-    std::vector<cv::Rect>   m_allFaces;
-    cv::Rect                m_trackedFace;
-    cv::Rect                m_faceRoi;
-    cv::Mat                 m_faceTemplate;
-    cv::Mat                 m_matchingResult;
-    bool                    m_templateMatchingRunning = false;
-    int64                   m_templateMatchingStartTime = 0;
-    int64                   m_templateMatchingCurrentTime = 0;
-    bool                    m_foundFace = false;
-    double                  m_scale;
-    int                     m_resizedWidth = 320;
-    cv::Point               m_facePosition;
-    double                  m_templateMatchingMaxDuration = 3;
-
-    cv::Rect    doubleRectSize(const cv::Rect &inputRect, const cv::Rect &frameSize) const;
-    cv::Rect    biggestFace(std::vector<cv::Rect> &faces) const;
-    cv::Point   centerOfRect(const cv::Rect &rect) const;
-    cv::Mat     getFaceTemplate(const cv::Mat &frame, cv::Rect face);
-    void        detectFaceAllSizes(const cv::Mat &frame);
-    void        detectFaceAroundRoi(const cv::Mat &frame);
-    void        detectFacesTemplateMatching(const cv::Mat &frame);
-};
+    std::unique_ptr<CaptureThread> m_captureThread;
+    size_t                  m_captureQueueSize = 2;
+    FrameQueue::OverflowPolicy m_captureOverflowPolicy = FrameQueue::DropOldest;
+    PixelFormat             m_inputFormat = PixelFormatBGR;
+    ResultLogWriter*        m_resultLog = NULL;
 
+    void                    checkScanConcurrency() const;
+    void                    logResults(const cv::Mat &frame);
+};
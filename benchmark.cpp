@@ -0,0 +1,584 @@
+#include <opencv2\highgui\highgui.hpp>
+#include <opencv2\imgproc\imgproc.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "DetectorStats.h"
+#include "TemplateMatcher.h"
+#include "TraceLog.h"
+#include "VideoFaceDetector.h"
+
+const cv::String    CASCADE_FILE("haarcascade_frontalface_default.xml");
+
+/*
+* Every operator new of the process is counted, so a run can check that the
+* detector stops allocating after warm-up. cv::Mat data comes from
+* cv::fastMalloc instead and is covered by VideoFaceDetector::bufferAllocations().
+*/
+static std::atomic<unsigned long long> heapAllocations(0);
+
+void *operator new(size_t size)
+{
+	heapAllocations++;
+	void *memory = std::malloc(size == 0 ? 1 : size);
+	if (memory == NULL)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void *operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void *memory, size_t) noexcept
+{
+	std::free(memory);
+}
+
+/*
+* Headless frame source producing the same sequence for the same seed. Faces
+* (a sprite image or a drawn face) move over a fixed noise background.
+*/
+class SyntheticCapture : public cv::VideoCapture
+{
+public:
+	SyntheticCapture(const int frameCount, const cv::Size size, const int faceCount,
+		const unsigned seed, const cv::Mat &sprite)
+		: m_frameCount(frameCount), m_size(size), m_faceCount(faceCount), m_seed(seed), m_sprite(sprite)
+	{
+		cv::RNG rng(seed);
+		m_background.create(size, CV_8UC3);
+		for (int y = 0; y < size.height; y++) {
+			cv::Vec3b *row = m_background.ptr<cv::Vec3b>(y);
+			for (int x = 0; x < size.width; x++) {
+				uchar value = (uchar)rng.uniform(60, 120);
+				row[x] = cv::Vec3b(value, value, value);
+			}
+		}
+
+		if (m_sprite.empty())
+			m_sprite = drawFace(cv::Size(size.height / 3, size.height / 3));
+	}
+
+	bool isOpened() const override
+	{
+		return true;
+	}
+
+	bool read(cv::OutputArray image) override
+	{
+		if (m_frameIndex >= m_frameCount) {
+			image.getMatRef().release();
+			return false;
+		}
+		render(image.getMatRef(), m_frameIndex++);
+		return true;
+	}
+
+	cv::VideoCapture& operator>>(cv::Mat &image) override
+	{
+		read(image);
+		return *this;
+	}
+
+	double get(int propId) const override
+	{
+		switch (propId) {
+		case cv::CAP_PROP_FRAME_WIDTH:  return m_size.width;
+		case cv::CAP_PROP_FRAME_HEIGHT: return m_size.height;
+		case cv::CAP_PROP_FRAME_COUNT:  return m_frameCount;
+		case cv::CAP_PROP_POS_FRAMES:   return m_frameIndex;
+		case cv::CAP_PROP_POS_MSEC:     return std::max(m_frameIndex - 1, 0) * 1000.0 / 30;
+		case cv::CAP_PROP_FPS:          return 30;
+		default:                        return 0;
+		}
+	}
+
+private:
+	int         m_frameCount;
+	int         m_frameIndex = 0;
+	cv::Size    m_size;
+	int         m_faceCount;
+	unsigned    m_seed;
+	cv::Mat     m_sprite;
+	cv::Mat     m_background;
+	cv::Mat     m_scaledSprite;
+
+	static cv::Mat drawFace(const cv::Size size)
+	{
+		cv::Mat face(size, CV_8UC3, cv::Scalar(90, 90, 90));
+		cv::Point center(size.width / 2, size.height / 2);
+		cv::ellipse(face, center, cv::Size(size.width * 2 / 5, size.height / 2), 0, 0, 360, cv::Scalar(150, 170, 210), cv::FILLED);
+		cv::ellipse(face, cv::Point(size.width * 7 / 20, size.height * 2 / 5), cv::Size(size.width / 12, size.height / 20), 0, 0, 360, cv::Scalar(40, 40, 40), cv::FILLED);
+		cv::ellipse(face, cv::Point(size.width * 13 / 20, size.height * 2 / 5), cv::Size(size.width / 12, size.height / 20), 0, 0, 360, cv::Scalar(40, 40, 40), cv::FILLED);
+		cv::rectangle(face, cv::Rect(size.width * 9 / 20, size.height * 9 / 20, size.width / 10, size.height / 6), cv::Scalar(120, 140, 180), cv::FILLED);
+		cv::ellipse(face, cv::Point(size.width / 2, size.height * 7 / 10), cv::Size(size.width / 6, size.height / 20), 0, 0, 360, cv::Scalar(60, 60, 140), cv::FILLED);
+		return face;
+	}
+
+	void render(cv::Mat &frame, const int index)
+	{
+		m_background.copyTo(frame);
+
+		for (int i = 0; i < m_faceCount; i++) {
+			// Faces follow Lissajous paths and slowly change size
+			double t = index / 30.0 + i * 1.7;
+			double scale = 0.8 + 0.2 * std::sin(t * 0.5 + i);
+			cv::Size spriteSize((int)(m_sprite.cols * scale), (int)(m_sprite.rows * scale));
+			int x = (int)((m_size.width - spriteSize.width) * (0.5 + 0.45 * std::sin(t * 0.7 + i)));
+			int y = (int)((m_size.height - spriteSize.height) * (0.5 + 0.45 * std::sin(t * 1.1 + 2 * i)));
+
+			cv::resize(m_sprite, m_scaledSprite, spriteSize);
+			cv::Rect target = cv::Rect(x, y, spriteSize.width, spriteSize.height) & cv::Rect(0, 0, m_size.width, m_size.height);
+			m_scaledSprite(cv::Rect(target.x - x, target.y - y, target.width, target.height)).copyTo(frame(target));
+		}
+
+		// Sensor noise, seeded per frame
+		cv::RNG rng(m_seed * 7919u + (unsigned)index);
+		for (int n = 0; n < m_size.area() / 64; n++) {
+			int px = rng.uniform(0, m_size.width);
+			int py = rng.uniform(0, m_size.height);
+			frame.at<cv::Vec3b>(py, px) = cv::Vec3b((uchar)rng.uniform(0, 256), (uchar)rng.uniform(0, 256), (uchar)rng.uniform(0, 256));
+		}
+	}
+};
+
+struct BenchmarkOptions
+{
+	std::vector<std::string>    videos;
+	int                         syntheticFrames = 300;
+	cv::Size                    syntheticSize = cv::Size(640, 480);
+	int                         syntheticFaces = 1;
+	unsigned                    seed = 1;
+	std::string                 sprite;
+	std::vector<int>            widths = { 160, 240, 320, 480 };
+	std::vector<std::string>    paths = { "auto", "full", "roi", "template" };
+	std::vector<std::string>    backends = { "opencv" };
+	std::vector<std::string>    trackers = { "template" };
+	int                         maxFrames = 0;
+	int                         warmupFrames = 30;
+	bool                        checkAllocations = false;
+	int                         maxFaces = 1;
+	int                         scanThreads = 1;
+	int                         changeGate = -1;
+	double                      resolutionBudget = -1;
+	double                      templateTimeout = 3;
+	std::vector<cv::Rect>       inclusions;
+	std::vector<cv::Rect>       exclusions;
+	bool                        perFrame = false;
+	int                         templateMatchingRuns = 0;
+	std::string                 cascade = CASCADE_FILE;
+	std::string                 traceFile;
+	TraceLog*                   trace = NULL;
+};
+
+static std::vector<std::string> split(const std::string &text)
+{
+	std::vector<std::string> parts;
+	std::stringstream stream(text);
+	std::string part;
+	while (std::getline(stream, part, ','))
+		parts.push_back(part);
+	return parts;
+}
+
+/*
+* Escapes text for a JSON string, e.g. Windows paths with backslashes.
+*/
+static std::string jsonEscape(const std::string &text)
+{
+	std::string escaped;
+	for (const char c : text) {
+		if (c == '"' || c == '\\') {
+			escaped += '\\';
+			escaped += c;
+		}
+		else if ((unsigned char)c < 0x20) {
+			char code[8];
+			snprintf(code, sizeof(code), "\\u%04x", (unsigned char)c);
+			escaped += code;
+		}
+		else {
+			escaped += c;
+		}
+	}
+	return escaped;
+}
+
+static void printUsage()
+{
+	fprintf(stderr,
+		"Usage: benchmark [options]\n"
+		"  --video FILE         recorded video to run (can be repeated)\n"
+		"  --synthetic N        number of synthetic frames, 0 to disable (default 300)\n"
+		"  --size WxH           synthetic frame size (default 640x480)\n"
+		"  --faces N            faces in synthetic frames (default 1)\n"
+		"  --sprite FILE        face image used in synthetic frames\n"
+		"  --seed N             synthetic sequence seed (default 1)\n"
+		"  --widths LIST        resized widths (default 160,240,320,480)\n"
+		"  --paths LIST         auto,full,roi,template (default all)\n"
+		"  --backends LIST      cascade backends opencv,compiled (default opencv)\n"
+		"  --trackers LIST      trackers template,correlation_filter (default template)\n"
+		"  --frames N           max frames per run, 0 for all (default 0)\n"
+		"  --warmup N           frames before allocations are counted (default 30)\n"
+		"  --check-allocations  fail runs that allocate after warm-up\n"
+		"  --max-faces N        tracked faces per detector (default 1)\n"
+		"  --scan-threads N     concurrent tasks of a full frame scan (default 1)\n"
+		"  --change-gate N      skip scans of unchanged frames, at most N in a row\n"
+		"                       (default off)\n"
+		"  --adaptive-resolution S  pick the resized width from face size and a\n"
+		"                       frame time budget of S seconds, 0 for no budget\n"
+		"  --include X,Y,W,H    only search faces centered in the rect, in frame\n"
+		"                       pixels (can be repeated)\n"
+		"  --exclude X,Y,W,H    never search faces centered in the rect (can be\n"
+		"                       repeated)\n"
+		"  --template-timeout S template matching max duration in seconds of frame\n"
+		"                       timestamps (default 3)\n"
+		"  --per-frame          print face count of every frame\n"
+		"  --template-matching N  only compare template matching kernels, N calls\n"
+		"                       per template size\n"
+		"  --cascade FILE       cascade file\n"
+		"  --trace FILE         write the stages of every frame as Chrome trace\n"
+		"                       JSON, one row per run\n");
+}
+
+static bool parseOptions(int argc, char **argv, BenchmarkOptions &options)
+{
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--per-frame") options.perFrame = true;
+		else if (arg == "--check-allocations") options.checkAllocations = true;
+		else if (!hasValue) return false;
+		else if (arg == "--video") options.videos.push_back(argv[++i]);
+		else if (arg == "--synthetic") options.syntheticFrames = atoi(argv[++i]);
+		else if (arg == "--size") {
+			if (sscanf(argv[++i], "%dx%d", &options.syntheticSize.width, &options.syntheticSize.height) != 2)
+				return false;
+		}
+		else if (arg == "--faces") options.syntheticFaces = atoi(argv[++i]);
+		else if (arg == "--sprite") options.sprite = argv[++i];
+		else if (arg == "--seed") options.seed = (unsigned)atoi(argv[++i]);
+		else if (arg == "--widths") {
+			options.widths.clear();
+			for (const auto &width : split(argv[++i]))
+				options.widths.push_back(atoi(width.c_str()));
+		}
+		else if (arg == "--paths") options.paths = split(argv[++i]);
+		else if (arg == "--backends") options.backends = split(argv[++i]);
+		else if (arg == "--trackers") options.trackers = split(argv[++i]);
+		else if (arg == "--frames") options.maxFrames = atoi(argv[++i]);
+		else if (arg == "--warmup") options.warmupFrames = atoi(argv[++i]);
+		else if (arg == "--max-faces") options.maxFaces = atoi(argv[++i]);
+		else if (arg == "--scan-threads") options.scanThreads = atoi(argv[++i]);
+		else if (arg == "--change-gate") options.changeGate = atoi(argv[++i]);
+		else if (arg == "--adaptive-resolution") options.resolutionBudget = atof(argv[++i]);
+		else if (arg == "--include" || arg == "--exclude") {
+			cv::Rect rect;
+			if (sscanf(argv[++i], "%d,%d,%d,%d", &rect.x, &rect.y, &rect.width, &rect.height) != 4)
+				return false;
+			(arg == "--include" ? options.inclusions : options.exclusions).push_back(rect);
+		}
+		else if (arg == "--template-timeout") options.templateTimeout = atof(argv[++i]);
+		else if (arg == "--template-matching") options.templateMatchingRuns = atoi(argv[++i]);
+		else if (arg == "--cascade") options.cascade = argv[++i];
+		else if (arg == "--trace") options.traceFile = argv[++i];
+		else return false;
+	}
+	return true;
+}
+
+static bool setBackend(VideoFaceDetector &detector, const std::string &backend)
+{
+	if (backend == "opencv") detector.setCascadeBackend(CascadeBackendOpenCV);
+	else if (backend == "compiled") detector.setCascadeBackend(CascadeBackendCompiled);
+	else return false;
+	return true;
+}
+
+static bool setTracker(VideoFaceDetector &detector, const std::string &tracker)
+{
+	if (tracker == "template") detector.setTrackerBackend(TrackerBackendTemplate);
+	else if (tracker == "correlation_filter") detector.setTrackerBackend(TrackerBackendCorrelationFilter);
+	else return false;
+	return true;
+}
+
+static bool setPath(VideoFaceDetector &detector, const std::string &path)
+{
+	if (path == "auto") detector.setForcedTrackingState(false);
+	else if (path == "full") detector.setForcedTrackingState(true, FullFrameDetection);
+	else if (path == "roi") detector.setForcedTrackingState(true, RoiDetection);
+	else if (path == "template") detector.setForcedTrackingState(true, TemplateMatching);
+	else return false;
+	return true;
+}
+
+/*
+* FNV-1a over every reported face so two builds can be compared frame for frame.
+*/
+static void hashValue(uint64 &hash, const int value)
+{
+	for (int i = 0; i < 4; i++) {
+		hash ^= (uint64)((value >> (8 * i)) & 0xff);
+		hash *= 1099511628211ull;
+	}
+}
+
+/*
+* Runs one detector configuration over capture and prints its results as one
+* JSON line. Returns false if the run couldn't be set up or, with
+* --check-allocations, if the detector allocated after warm-up.
+*/
+static bool runBenchmark(const BenchmarkOptions &options, const std::string &source,
+	cv::VideoCapture &capture, const int width, const std::string &path, const std::string &backend,
+	const std::string &tracker)
+{
+	VideoFaceDetector detector(options.cascade, capture);
+	detector.setResizedWidth(width);
+	detector.setMaxTrackedFaces(options.maxFaces);
+	detector.setScanConcurrency(options.scanThreads);
+	if (options.changeGate >= 0)
+		detector.setChangeGate(true, options.changeGate);
+	if (options.resolutionBudget >= 0) {
+		detector.setAdaptiveResolution(true);
+		detector.resolutionController().setFrameTimeBudget(options.resolutionBudget);
+	}
+	detector.setTemplateMatchingMaxDuration(options.templateTimeout);
+	for (const auto &rect : options.inclusions)
+		detector.searchMask().include(rect);
+	for (const auto &rect : options.exclusions)
+		detector.searchMask().exclude(rect);
+	if (!setPath(detector, path)) {
+		fprintf(stderr, "Unknown path %s\n", path.c_str());
+		return false;
+	}
+	if (!setBackend(detector, backend)) {
+		fprintf(stderr, "Unknown backend %s\n", backend.c_str());
+		return false;
+	}
+	if (!setTracker(detector, tracker)) {
+		fprintf(stderr, "Unknown tracker %s\n", tracker.c_str());
+		return false;
+	}
+	if (options.trace != NULL) {
+		static int traceTrack = 0;
+		detector.setTrace(options.trace, traceTrack);
+		options.trace->setTrackName(traceTrack++, source + " " + std::to_string(width) + " " + path + " " + backend + " " + tracker);
+	}
+
+	LatencyHistogram latency;
+	uint64 detections = 0;
+	uint64 framesWithFaces = 0;
+	uint64 workingWidthSum = 0;
+	uint64 hash = 1469598103934665603ull;
+	std::map<int, int> trackFrames;
+	std::string perFrame;
+	cv::Mat frame;
+	int frameIndex = 0;
+
+	// Allocations are counted around the detector only, after the warm-up frames
+	unsigned long long heapAllocationsAfterWarmup = 0;
+	uint64 warmBufferAllocations = detector.bufferAllocations();
+
+	auto runStart = std::chrono::steady_clock::now();
+	while (options.maxFrames == 0 || frameIndex < options.maxFrames) {
+		unsigned long long heapAllocationsBefore = heapAllocations;
+		auto start = std::chrono::steady_clock::now();
+		detector >> frame;
+		auto end = std::chrono::steady_clock::now();
+		unsigned long long heapAllocationsAfter = heapAllocations;
+		if (frame.empty())
+			break;
+
+		if (frameIndex < options.warmupFrames)
+			warmBufferAllocations = detector.bufferAllocations();
+		else
+			heapAllocationsAfterWarmup += heapAllocationsAfter - heapAllocationsBefore;
+		latency.record((uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+		workingWidthSum += detector.workingWidth();
+
+		std::vector<TrackedFace> faces = detector.faces();
+		detections += faces.size();
+		framesWithFaces += faces.empty() ? 0 : 1;
+		hashValue(hash, frameIndex);
+		for (const auto &face : faces) {
+			trackFrames[face.id]++;
+			hashValue(hash, face.face.x);
+			hashValue(hash, face.face.y);
+			hashValue(hash, face.face.width);
+			hashValue(hash, face.face.height);
+		}
+		if (options.perFrame)
+			perFrame += (frameIndex ? "," : "") + std::to_string(faces.size());
+
+		frameIndex++;
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+
+	// Continuity: fewer, longer tracks mean faces were lost less often
+	uint64 trackedFrames = 0;
+	for (const auto &track : trackFrames)
+		trackedFrames += track.second;
+	double meanTrackFrames = trackFrames.empty() ? 0. : (double)trackedFrames / trackFrames.size();
+	uint64 bufferAllocationsAfterWarmup = detector.bufferAllocations() - warmBufferAllocations;
+
+	printf("{\"source\":\"%s\",\"width\":%d,\"path\":\"%s\",\"backend\":\"%s\",\"tracker\":\"%s\",\"frames\":%d,\"fps\":%.3f,"
+		"\"latency_us\":{\"p50\":%.1f,\"p99\":%.1f,\"max\":%.1f},"
+		"\"detections\":%llu,\"frames_with_faces\":%llu,\"tracks\":%d,\"mean_track_frames\":%.1f,\"result_hash\":\"%016llx\"",
+		jsonEscape(source).c_str(), width, path.c_str(), backend.c_str(), tracker.c_str(), frameIndex, seconds > 0 ? frameIndex / seconds : 0.,
+		latency.percentile(50) / 1e3, latency.percentile(99) / 1e3, latency.max() / 1e3,
+		(unsigned long long)detections, (unsigned long long)framesWithFaces, (int)trackFrames.size(), meanTrackFrames,
+		(unsigned long long)hash);
+	if (options.resolutionBudget >= 0)
+		printf(",\"mean_working_width\":%.1f", frameIndex ? (double)workingWidthSum / frameIndex : 0.);
+	if (options.perFrame)
+		printf(",\"faces_per_frame\":[%s]", perFrame.c_str());
+	printf(",\"allocations_after_warmup\":{\"heap\":%llu,\"buffers\":%llu}",
+		heapAllocationsAfterWarmup, (unsigned long long)bufferAllocationsAfterWarmup);
+	printf(",\"stats\":%s}\n", detector.stats().toJson().c_str());
+	fflush(stdout);
+
+	if (options.checkAllocations && (heapAllocationsAfterWarmup > 0 || bufferAllocationsAfterWarmup > 0)) {
+		fprintf(stderr, "%s %d %s %s %s allocated after warm-up: %llu heap, %llu buffers\n",
+			source.c_str(), width, path.c_str(), backend.c_str(), tracker.c_str(),
+			heapAllocationsAfterWarmup, (unsigned long long)bufferAllocationsAfterWarmup);
+		return false;
+	}
+	return true;
+}
+
+/*
+* Compares TemplateMatcher against matchTemplate + normalize + minMaxLoc on
+* the template and roi sizes the tracker sees: the template is half the face
+* and the roi around 1.5 faces, so the roi is three templates wide.
+*/
+static void runTemplateMatchingBenchmark(const BenchmarkOptions &options)
+{
+	const int templateSizes[] = { 8, 12, 16, 24, 32, 48 };
+	const int types[] = { CV_8UC1, CV_8UC3 };
+	cv::RNG rng(options.seed);
+
+	for (const auto &type : types) {
+		for (const auto &templateSize : templateSizes) {
+			cv::Mat roi(templateSize * 3, templateSize * 3, type);
+			rng.fill(roi, cv::RNG::UNIFORM, 0, 256);
+			cv::Point expected(rng.uniform(0, templateSize * 2 + 1), rng.uniform(0, templateSize * 2 + 1));
+			cv::Mat templ = roi(cv::Rect(expected, cv::Size(templateSize, templateSize))).clone();
+
+			cv::Mat result;
+			double min, max;
+			cv::Point minLoc, maxLoc;
+			LatencyHistogram reference;
+			for (int i = 0; i < options.templateMatchingRuns; i++) {
+				auto start = std::chrono::steady_clock::now();
+				cv::matchTemplate(roi, templ, result, CV_TM_SQDIFF_NORMED);
+				cv::normalize(result, result, 0, 1, cv::NORM_MINMAX, -1, cv::Mat());
+				cv::minMaxLoc(result, &min, &max, &minLoc, &maxLoc);
+				reference.record((uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+			}
+
+			cv::Point location;
+			LatencyHistogram fused;
+			for (int i = 0; i < options.templateMatchingRuns; i++) {
+				auto start = std::chrono::steady_clock::now();
+				TemplateMatcher::match(roi, templ, location);
+				fused.record((uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+			}
+
+			printf("{\"template_matching\":\"%s\",\"channels\":%d,\"template\":%d,\"roi\":%d,\"runs\":%d,"
+				"\"opencv_us\":{\"p50\":%.2f,\"p99\":%.2f},\"fused_us\":{\"p50\":%.2f,\"p99\":%.2f},"
+				"\"same_location\":%s}\n",
+				TemplateMatcher::kernelName(), CV_MAT_CN(type), templateSize, roi.cols, options.templateMatchingRuns,
+				reference.percentile(50) / 1e3, reference.percentile(99) / 1e3,
+				fused.percentile(50) / 1e3, fused.percentile(99) / 1e3,
+				location == minLoc ? "true" : "false");
+			fflush(stdout);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	BenchmarkOptions options;
+	if (!parseOptions(argc, argv, options)) {
+		printUsage();
+		return 1;
+	}
+
+	if (options.templateMatchingRuns > 0) {
+		runTemplateMatchingBenchmark(options);
+		return 0;
+	}
+
+	TraceLog trace;
+	if (!options.traceFile.empty())
+		options.trace = &trace;
+
+	cv::Mat sprite;
+	if (!options.sprite.empty()) {
+		sprite = cv::imread(options.sprite);
+		if (sprite.empty()) {
+			fprintf(stderr, "Error reading sprite %s\n", options.sprite.c_str());
+			return 1;
+		}
+	}
+
+	int exitCode = 0;
+	for (const auto &backend : options.backends) {
+		for (const auto &tracker : options.trackers) {
+			for (const auto &width : options.widths) {
+				for (const auto &path : options.paths) {
+					for (const auto &video : options.videos) {
+						cv::VideoCapture capture(video);
+						if (!capture.isOpened()) {
+							fprintf(stderr, "Error opening video %s\n", video.c_str());
+							return 1;
+						}
+						if (!runBenchmark(options, video, capture, width, path, backend, tracker))
+							exitCode = 1;
+					}
+
+					if (options.syntheticFrames > 0) {
+						SyntheticCapture capture(options.syntheticFrames, options.syntheticSize,
+							options.syntheticFaces, options.seed, sprite);
+						if (!runBenchmark(options, "synthetic", capture, width, path, backend, tracker))
+							exitCode = 1;
+					}
+				}
+			}
+		}
+	}
+
+	if (options.trace != NULL && !trace.save(options.traceFile))
+		return 1;
+
+	return exitCode;
+}
@@ -0,0 +1,68 @@
+#include <opencv2\core.hpp>
+
+#include <cstdio>
+#include <string>
+
+#include "HaarCascadeTables.h"
+
+/*
+* Build step converting a Haar cascade of stumps into C++ tables for
+* HaarEvaluator.
+*
+*     cascade_codegen haarcascade_frontalface_default.xml FrontalFaceCascade.inc FRONTAL_FACE
+*/
+
+int main(int argc, char** argv)
+{
+	if (argc != 4) {
+		fprintf(stderr, "Usage: cascade_codegen CASCADE_XML OUTPUT NAME\n");
+		return 1;
+	}
+
+	std::string input = argv[1];
+	std::string name = argv[3];
+
+	cv::FileStorage fs(input, cv::FileStorage::READ);
+	if (!fs.isOpened()) {
+		fprintf(stderr, "cascade_codegen: %s: can't open cascade\n", input.c_str());
+		return 1;
+	}
+
+	HaarCascadeTables tables;
+	std::string error;
+	if (!tables.read(fs.getFirstTopLevelNode(), error)) {
+		fprintf(stderr, "cascade_codegen: %s: %s\n", input.c_str(), error.c_str());
+		return 1;
+	}
+	const HaarCascade &cascade = tables.cascade();
+
+	FILE *output = fopen(argv[2], "w");
+	if (output == NULL) {
+		fprintf(stderr, "cascade_codegen: can't write %s\n", argv[2]);
+		return 1;
+	}
+
+	fprintf(output, "// Generated by cascade_codegen from %s, do not edit.\n\n", input.c_str());
+
+	fprintf(output, "static const HaarRect %s_RECTS[] = {\n", name.c_str());
+	for (const auto &rect : tables.rects())
+		fprintf(output, "    { %d, %d, %d, %d, %d },\n", rect.x, rect.y, rect.width, rect.height, rect.weight);
+	fprintf(output, "};\n\n");
+
+	fprintf(output, "static const HaarStump %s_STUMPS[] = {\n", name.c_str());
+	for (const auto &stump : tables.stumps())
+		fprintf(output, "    { %u, %u, %.9ef, %.9ef, %.9ef },\n", stump.firstRect, stump.rectCount,
+			stump.threshold, stump.left, stump.right);
+	fprintf(output, "};\n\n");
+
+	fprintf(output, "static const HaarStage %s_STAGES[] = {\n", name.c_str());
+	for (const auto &stage : tables.stages())
+		fprintf(output, "    { %u, %u, %.9ef },\n", stage.firstStump, stage.stumpCount, stage.threshold);
+	fprintf(output, "};\n\n");
+
+	fprintf(output, "static const HaarCascade %s_CASCADE = { %d, %d, %d, %s_STAGES, %s_STUMPS, %s_RECTS };\n",
+		name.c_str(), cascade.width, cascade.height, cascade.stageCount, name.c_str(), name.c_str(), name.c_str());
+
+	fclose(output);
+	return 0;
+}
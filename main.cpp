@@ -23,9 +23,9 @@ int main(int argc, char** argv)
 	double fps = 0, time_per_frame;
 	while (true)
 	{
-		auto start = cv::getCPUTickCount();
+		auto start = cv::getTickCount();
 		detector >> frame;
-		auto end = cv::getCPUTickCount();
+		auto end = cv::getTickCount();
 
 		time_per_frame = (end - start) / cv::getTickFrequency();
 		fps = (15 * fps + (1 / time_per_frame)) / 16;
@@ -42,5 +42,7 @@ int main(int argc, char** argv)
 		if (cv::waitKey(25) == 27) break;
 	}
 
+	printf("%s\n", detector.stats().toJson().c_str());
+
 	return 0;
 }
\ No newline at end of file
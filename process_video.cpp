@@ -0,0 +1,108 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+#include "ResultLog.h"
+#include "SegmentProcessor.h"
+
+const cv::String    CASCADE_FILE("haarcascade_frontalface_default.xml");
+
+static void printUsage()
+{
+	fprintf(stderr,
+		"Usage: process_video VIDEO [options]\n"
+		"  --output FILE        csv output (default VIDEO.faces.csv)\n"
+		"  --log FILE           also append results to a binary result log\n"
+		"  --segment N          frames per segment, ideally a multiple of the GOP size (default 250)\n"
+		"  --overlap N          frames tracked before every segment to stitch ids (default 10)\n"
+		"  --threads N          worker threads, 0 for one per core (default 0)\n"
+		"  --width N            resized width (default 320)\n"
+		"  --max-faces N        tracked faces (default 1)\n"
+		"  --template-timeout S template matching max duration in seconds of frame\n"
+		"                       timestamps (default 3)\n"
+		"  --cascade FILE       cascade file\n");
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2) {
+		printUsage();
+		return 1;
+	}
+
+	std::string video = argv[1];
+	std::string output = video + ".faces.csv";
+	std::string log;
+	std::string cascade = CASCADE_FILE;
+	int segmentLength = 250, overlap = 10, threads = 0, width = 320, maxFaces = 1;
+	double templateTimeout = 3;
+	for (int i = 2; i < argc; i++) {
+		std::string arg = argv[i];
+		if (i + 1 >= argc) {
+			printUsage();
+			return 1;
+		}
+		if (arg == "--output") output = argv[++i];
+		else if (arg == "--log") log = argv[++i];
+		else if (arg == "--segment") segmentLength = atoi(argv[++i]);
+		else if (arg == "--overlap") overlap = atoi(argv[++i]);
+		else if (arg == "--threads") threads = atoi(argv[++i]);
+		else if (arg == "--width") width = atoi(argv[++i]);
+		else if (arg == "--max-faces") maxFaces = atoi(argv[++i]);
+		else if (arg == "--template-timeout") templateTimeout = atof(argv[++i]);
+		else if (arg == "--cascade") cascade = argv[++i];
+		else {
+			printUsage();
+			return 1;
+		}
+	}
+
+	SegmentProcessor processor(cascade, threads);
+	processor.setSegmentLength(segmentLength);
+	processor.setOverlap(overlap);
+	processor.setDetectorSetup([&](VideoFaceDetector &detector) {
+		detector.setResizedWidth(width);
+		detector.setMaxTrackedFaces(maxFaces);
+		detector.setTemplateMatchingMaxDuration(templateTimeout);
+	});
+
+	std::ofstream csv(output);
+	if (!csv) {
+		fprintf(stderr, "Error opening output file %s\n", output.c_str());
+		return 1;
+	}
+	ResultLogWriter logWriter;
+	if (!log.empty() && !logWriter.open(log))
+		return 1;
+
+	// Results arrive segment by segment, one csv line per face
+	size_t frames = 0;
+	csv << "frame,id,x,y,width,height\n";
+	processor.setResultCallback([&](const FrameFaces &frame) {
+		for (const auto &face : frame.faces) {
+			csv << frame.frameIndex << ',' << face.id << ',' << face.face.x << ',' << face.face.y << ','
+				<< face.face.width << ',' << face.face.height << '\n';
+		}
+		if (logWriter.isOpened())
+			logWriter.append(frame.frameIndex, frame.timestamp, frame.faces);
+		frames++;
+	});
+
+	auto start = std::chrono::steady_clock::now();
+	bool processed = processor.process(video);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	logWriter.close();
+	csv.close();
+	if (!processed)
+		return 1;
+	if (!csv) {
+		fprintf(stderr, "Error writing output file %s\n", output.c_str());
+		return 1;
+	}
+
+	fprintf(stderr, "%zu frames in %d segments, %.1f s, %.1f fps\n",
+		frames, processor.segmentCount(), seconds, seconds > 0 ? frames / seconds : 0.);
+	return 0;
+}